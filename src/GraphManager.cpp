@@ -1,17 +1,45 @@
 #include "GraphManager.h"
 #include <QDataStream>
 #include <QFile>
-#include <QUuid>
+#include <QSignalBlocker>
+#include <QTimer>
 #include <algorithm>
+#include <cstring>
 #include <queue>
 #include <unordered_map>
 #include <unordered_set>
 #include "nodes/InputNode.h"
 #include "nodes/OutputNode.h"
 #include "nodes/BrightnessContrastNode.h"
+#include "nodes/NodeRegistry.h"
+#include "ProjectFormat.h"
+#include "utils/ImageUtils.h"
+
+// Journal entries recorded before the snapshot is rewritten
+const size_t kJournalCompactionInterval = 256;
+
+namespace {
+
+// Hash of a node's type and parameter values
+uint64_t hashNodeSettings(const Node* node) {
+    const std::string& typeName = node->getTypeName();
+    uint64_t hash = ImageUtils::hashBytes(typeName.data(), typeName.size());
+    
+    for (const NodeParameter& parameter : node->getParameters()) {
+        uint64_t valueBits;
+        std::memcpy(&valueBits, &parameter.value, sizeof(valueBits));
+        hash = ImageUtils::combineHash(hash, ImageUtils::hashBytes(parameter.name.data(), parameter.name.size()));
+        hash = ImageUtils::combineHash(hash, valueBits);
+        hash = ImageUtils::combineHash(hash, ImageUtils::hashBytes(parameter.text.data(), parameter.text.size()));
+    }
+    
+    return hash;
+}
+
+} // namespace
 
 GraphManager::GraphManager(QObject* parent)
-    : QObject(parent), selectedNode_(nullptr), dirty_(false) {
+    : QObject(parent), selectedNode_(nullptr), dirty_(false), processingScheduled_(false) {
 }
 
 GraphManager::~GraphManager() {
@@ -22,7 +50,7 @@ void GraphManager::addNode(Node* node) {
     if (!node) return;
     
     // Add node to list
-    nodes_.push_back(node);
+    attachNode(node);
     
     // Set position if not set
     if (node->getPosition().x() == 0 && node->getPosition().y() == 0) {
@@ -32,25 +60,39 @@ void GraphManager::addNode(Node* node) {
         node->setPosition(QPoint(x, y));
     }
     
-    // Connect signals
-    connect(node, &Node::processingRequested, this, &GraphManager::processAll);
-    connect(node, &Node::connectionStarted, [this](NodeConnector* connector) {
-        // This would be used for interactive connection creation in the UI
-    });
-    connect(node, &Node::nodeChanged, [this]() {
-        dirty_ = true;
-    });
-    
     // Emit signal
     emit nodeAdded(node);
     
+    // Record the edit for autosave
+    if (journal_) {
+        journal_->recordNodeAdded(node->getId(), node->getTypeName(), node->getPosition(), node->getParameters());
+        journaledSettings_[node] = hashNodeSettings(node);
+        compactJournal();
+    }
+    
     // Mark graph as dirty
     dirty_ = true;
 }
 
+void GraphManager::attachNode(Node* node) {
+    nodes_.push_back(node);
+    
+    // Connect signals
+    connect(node, &Node::processingRequested, this, &GraphManager::processAll);
+    connect(node, &Node::connectionStarted, [this](NodeConnector* connector) {
+        // This would be used for interactive connection creation in the UI
+    });
+}
+
 void GraphManager::removeNode(Node* node) {
     if (!node) return;
     
+    // Record the edit for autosave, replaying it also drops the node's connections
+    if (journal_) {
+        journal_->recordNodeRemoved(node->getId());
+    }
+    journaledSettings_.erase(node);
+    
     // First, remove all connections to this node
     auto it = connections_.begin();
     while (it != connections_.end()) {
@@ -90,6 +132,8 @@ void GraphManager::removeNode(Node* node) {
     
     // Mark graph as dirty
     dirty_ = true;
+    
+    compactJournal();
 }
 
 void GraphManager::selectNode(Node* node) {
@@ -169,6 +213,21 @@ bool GraphManager::connect(NodeConnector* source, NodeConnector* destination) {
     }
     
     // Create connection
+    Connection* connection = attachConnection(source, destination);
+    
+    // Emit signal
+    emit connectionAdded(connection);
+    
+    // Record the edit for autosave
+    journalConnection(ProjectJournal::EntryType::ConnectionAdded, source, destination);
+    
+    // Mark graph as dirty
+    dirty_ = true;
+    
+    return true;
+}
+
+Connection* GraphManager::attachConnection(NodeConnector* source, NodeConnector* destination) {
     Connection* connection = new Connection(source, destination);
     connections_.push_back(connection);
     
@@ -179,13 +238,7 @@ bool GraphManager::connect(NodeConnector* source, NodeConnector* destination) {
     // Mark destination node as dirty
     destination->getParentNode()->markDirty();
     
-    // Emit signal
-    emit connectionAdded(connection);
-    
-    // Mark graph as dirty
-    dirty_ = true;
-    
-    return true;
+    return connection;
 }
 
 void GraphManager::disconnect(Connection* connection) {
@@ -194,6 +247,9 @@ void GraphManager::disconnect(Connection* connection) {
     // Find and remove connection
     auto it = std::find(connections_.begin(), connections_.end(), connection);
     if (it != connections_.end()) {
+        // Record the edit for autosave
+        journalConnection(ProjectJournal::EntryType::ConnectionRemoved, connection->getSource(), connection->getDestination());
+        
         // Remove from connectors
         connection->getSource()->removeConnection(connection);
         connection->getDestination()->removeConnection(connection);
@@ -220,18 +276,72 @@ const std::vector<Connection*>& GraphManager::getConnections() const {
 }
 
 void GraphManager::processAll() {
+    // A direct call satisfies any pending deferred request
+    processingScheduled_ = false;
+    
     // Calculate processing order
     std::vector<Node*> processingOrder = calculateProcessingOrder();
     
     // Process each node in order
     for (Node* node : processingOrder) {
-        if (node->isDirty()) {
-            node->process();
+        const std::vector<NodeConnector*>& inputConnectors = node->getInputConnectors();
+        
+        // Parameter edits reach the graph as processing requests, journal them here
+        uint64_t settings = hashNodeSettings(node);
+        journalParameters(node, settings);
+        
+        // Source nodes read from outside the graph, their dirty flag is authoritative
+        if (inputConnectors.empty()) {
+            if (node->isDirty()) {
+                node->process();
+                node->setThumbnail(QImage());
+            }
+            continue;
         }
+        
+        // Settings plus the content hash of every input, upstream hashes are already current
+        uint64_t signature = settings;
+        for (NodeConnector* input : inputConnectors) {
+            if (input->getConnections().empty()) {
+                signature = ImageUtils::combineHash(signature, 0);
+                continue;
+            }
+            NodeConnector* source = input->getConnections()[0]->getSource();
+            signature = ImageUtils::combineHash(signature, source->getParentNode()->getOutputHash(source->getIndex()));
+        }
+        
+        // Outputs restored from a project file are taken as current for their inputs
+        if (!node->isDirty() && node->getInputSignature() == 0) {
+            node->setInputSignature(signature);
+        }
+        
+        // Identical inputs and settings produce identical outputs
+        if (signature == node->getInputSignature()) {
+            node->markClean();
+            continue;
+        }
+        
+        node->process();
+        node->setInputSignature(signature);
+        
+        // Embedded previews are only shown until the node has real output
+        node->setThumbnail(QImage());
     }
 }
 
-std::vector<Node*> GraphManager::calculateProcessingOrder() {
+void GraphManager::scheduleProcessing() {
+    // Coalesce requests into a single evaluation once control returns to the event loop
+    if (processingScheduled_) return;
+    processingScheduled_ = true;
+    
+    QTimer::singleShot(0, this, [this]() {
+        if (processingScheduled_) {
+            processAll();
+        }
+    });
+}
+
+std::vector<Node*> GraphManager::calculateProcessingOrder() const {
     std::vector<Node*> result;
     std::unordered_map<Node*, int> inDegree;
     std::unordered_map<Node*, std::vector<Node*>> graph;
@@ -280,143 +390,508 @@ std::vector<Node*> GraphManager::calculateProcessingOrder() {
     return result;
 }
 
-bool GraphManager::saveToFile(const std::string& filePath) {
+std::unordered_map<Node*, uint64_t> GraphManager::computeSignatures() const {
+    std::unordered_map<Node*, uint64_t> signatures;
+    
+    // Visit nodes in processing order so upstream signatures are known
+    for (Node* node : calculateProcessingOrder()) {
+        // Type and parameters
+        uint64_t signature = hashNodeSettings(node);
+        
+        // Upstream nodes and the output each input is taken from
+        const std::vector<NodeConnector*>& inputConnectors = node->getInputConnectors();
+        for (NodeConnector* input : inputConnectors) {
+            if (input->getConnections().empty()) {
+                signature = ImageUtils::combineHash(signature, 0);
+                continue;
+            }
+            NodeConnector* source = input->getConnections()[0]->getSource();
+            signature = ImageUtils::combineHash(signature, signatures[source->getParentNode()]);
+            signature = ImageUtils::combineHash(signature, static_cast<uint64_t>(source->getIndex()));
+        }
+        
+        // Source nodes contribute their content, e.g. the loaded image
+        if (inputConnectors.empty()) {
+            for (size_t i = 0; i < node->getOutputConnectors().size(); i++) {
+                signature = ImageUtils::combineHash(signature, ImageUtils::hashImage(node->getOutputImage(static_cast<int>(i))));
+            }
+        }
+        
+        signatures[node] = signature;
+    }
+    
+    return signatures;
+}
+
+bool GraphManager::saveToFile(const std::string& filePath, const ProjectSaveOptions& options) {
     QFile file(QString::fromStdString(filePath));
     if (!file.open(QIODevice::WriteOnly)) {
         return false;
     }
     
-    QDataStream stream(&file);
-    stream.setVersion(QDataStream::Qt_5_15);
-    
-    // Write magic number and version
-    stream << QString("NIP"); // Magic number
-    stream << quint32(1);     // Version 1
-    
-    // Write nodes
-    writeNodes(stream);
-    
-    // Write connections
-    writeConnections(stream);
+    // Serialize the whole graph into one buffer and write it in a single call
+    QByteArray data = serializeGraph(options);
+    bool written = file.write(data) == data.size();
     
     file.close();
     
+    if (!written) {
+        return false;
+    }
+    
     // Update current file path
     currentFilePath_ = filePath;
     
     // Clear dirty flag
     dirty_ = false;
     
+    // The saved state becomes the new autosave baseline
+    compactJournal(true);
+    
     return true;
 }
 
-void GraphManager::writeNodes(QDataStream& stream) {
-    // Write number of nodes
-    stream << quint32(nodes_.size());
+QByteArray GraphManager::serializeGraph(const ProjectSaveOptions& options) const {
+    using namespace ProjectFormat;
+    
+    std::vector<TypeRecord> types;
+    std::vector<FieldRecord> fields;
+    std::vector<NodeRecord> nodeRecords;
+    std::vector<ParameterRecord> parameters;
+    std::vector<ConnectionRecord> connectionRecords;
+    
+    // String table, each distinct string is stored once
+    std::string strings(1, '\0');
+    std::unordered_map<std::string, uint32_t> stringOffsets = {{"", 0}};
+    auto internString = [&](const std::string& text) {
+        auto it = stringOffsets.find(text);
+        if (it != stringOffsets.end()) {
+            return it->second;
+        }
+        uint32_t offset = static_cast<uint32_t>(strings.size());
+        strings.append(text);
+        strings.push_back('\0');
+        stringOffsets.emplace(text, offset);
+        return offset;
+    };
     
-    // Create a map of node pointers to IDs
-    std::unordered_map<Node*, QString> nodeIds;
+    std::unordered_map<std::string, uint32_t> typeIndices;
+    std::unordered_map<Node*, uint32_t> nodeIndices;
+    nodeRecords.reserve(nodes_.size());
     
     // Write each node
     for (Node* node : nodes_) {
-        // Generate unique ID for this node
-        QString nodeId = QUuid::createUuid().toString();
-        nodeIds[node] = nodeId;
+        std::vector<NodeParameter> nodeParameters = node->getParameters();
         
-        // Write node ID
-        stream << nodeId;
+        // The first node of a type defines the parameter schema for that type
+        auto typeIt = typeIndices.find(node->getTypeName());
+        if (typeIt == typeIndices.end()) {
+            TypeRecord type = {};
+            type.nameOffset = internString(node->getTypeName());
+            type.firstField = static_cast<uint32_t>(fields.size());
+            type.fieldCount = static_cast<uint32_t>(nodeParameters.size());
+            for (const NodeParameter& parameter : nodeParameters) {
+                fields.push_back({internString(parameter.name), 0});
+            }
+            typeIt = typeIndices.emplace(node->getTypeName(), static_cast<uint32_t>(types.size())).first;
+            types.push_back(type);
+        }
+        const TypeRecord& type = types[typeIt->second];
         
-        // Write node type
-        stream << quint32(static_cast<int>(node->getType()));
+        NodeRecord record = {};
+        record.typeIndex = typeIt->second;
+        record.nameOffset = internString(node->getName());
+        record.x = static_cast<float>(node->getPosition().x());
+        record.y = static_cast<float>(node->getPosition().y());
+        record.firstParameter = static_cast<uint32_t>(parameters.size());
         
-        // Write node name
-        stream << QString::fromStdString(node->getName());
+        // Store values in schema order
+        for (uint32_t f = 0; f < type.fieldCount; f++) {
+            const char* fieldName = strings.c_str() + fields[type.firstField + f].nameOffset;
+            ParameterRecord value = {};
+            
+            // Parameters normally come back in schema order, fall back to a lookup by name
+            const NodeParameter* parameter = nullptr;
+            if (f < nodeParameters.size() && nodeParameters[f].name == fieldName) {
+                parameter = &nodeParameters[f];
+            } else {
+                for (const NodeParameter& candidate : nodeParameters) {
+                    if (candidate.name == fieldName) {
+                        parameter = &candidate;
+                        break;
+                    }
+                }
+            }
+            
+            if (parameter) {
+                value.value = parameter->value;
+                value.textOffset = internString(parameter->text);
+            }
+            parameters.push_back(value);
+        }
         
-        // Write node position
-        stream << node->getPosition();
+        nodeIndices[node] = static_cast<uint32_t>(nodeRecords.size());
+        nodeRecords.push_back(record);
+    }
+    
+    // Write each connection as a pair of (node index, connector index)
+    connectionRecords.reserve(connections_.size());
+    for (Connection* connection : connections_) {
+        NodeConnector* source = connection->getSource();
+        NodeConnector* destination = connection->getDestination();
         
-        // Write node-specific data based on type
-        switch (node->getType()) {
-            case NodeType::Input: {
-                InputNode* inputNode = static_cast<InputNode*>(node);
-                stream << QString::fromStdString(inputNode->getImagePath());
-                break;
-            }
-            case NodeType::Output: {
-                // No specific data for OutputNode yet
-                break;
+        ConnectionRecord record = {};
+        record.sourceNode = nodeIndices[source->getParentNode()];
+        record.destinationNode = nodeIndices[destination->getParentNode()];
+        record.sourcePort = static_cast<uint16_t>(source->getIndex());
+        record.destinationPort = static_cast<uint16_t>(destination->getIndex());
+        connectionRecords.push_back(record);
+    }
+    
+    // Encode embedded results up front so the payload sizes are known
+    std::vector<ResultRecord> results;
+    std::vector<std::vector<uchar>> payloads;
+    if (options.embedResults) {
+        std::unordered_map<Node*, uint64_t> signatures = computeSignatures();
+        std::unordered_set<Node*> fullResolution(options.fullResolutionNodes.begin(), options.fullResolutionNodes.end());
+        
+        for (Node* node : nodes_) {
+            // A dirty node's output does not match its current parameters
+            if (node->isDirty()) {
+                continue;
             }
-            case NodeType::Processing: {
-                // Check for specific processing node types
-                if (BrightnessContrastNode* bcNode = dynamic_cast<BrightnessContrastNode*>(node)) {
-                    stream << qint32(bcNode->getBrightness());
-                    stream << qreal(bcNode->getContrast());
+            
+            bool full = fullResolution.count(node) > 0;
+            for (size_t port = 0; port < node->getOutputConnectors().size(); port++) {
+                cv::Mat image = node->getOutputImage(static_cast<int>(port));
+                if (!full) {
+                    image = ImageUtils::makeThumbnail(image, options.thumbnailSize);
                 }
-                // Add more node-specific saving here
-                break;
+                
+                std::vector<uchar> encoded;
+                if (!encodeResult(image, full, encoded)) {
+                    continue;
+                }
+                
+                ResultRecord record = {};
+                record.signature = signatures[node];
+                record.nodeIndex = nodeIndices[node];
+                record.port = static_cast<uint32_t>(port);
+                record.kind = full ? ResultKind::FullResolution : ResultKind::Thumbnail;
+                record.encodedSize = static_cast<uint32_t>(encoded.size());
+                results.push_back(record);
+                payloads.push_back(std::move(encoded));
             }
-            default:
-                break;
         }
     }
+    
+    // Lay out the sections
+    FileHeader header = {};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.typeCount = static_cast<uint32_t>(types.size());
+    header.fieldCount = static_cast<uint32_t>(fields.size());
+    header.nodeCount = static_cast<uint32_t>(nodeRecords.size());
+    header.parameterCount = static_cast<uint32_t>(parameters.size());
+    header.connectionCount = static_cast<uint32_t>(connectionRecords.size());
+    header.stringTableSize = static_cast<uint32_t>(strings.size());
+    header.typeOffset = alignSection(sizeof(FileHeader));
+    header.fieldOffset = alignSection(header.typeOffset + types.size() * sizeof(TypeRecord));
+    header.nodeOffset = alignSection(header.fieldOffset + fields.size() * sizeof(FieldRecord));
+    header.parameterOffset = alignSection(header.nodeOffset + nodeRecords.size() * sizeof(NodeRecord));
+    header.connectionOffset = alignSection(header.parameterOffset + parameters.size() * sizeof(ParameterRecord));
+    header.stringOffset = alignSection(header.connectionOffset + connectionRecords.size() * sizeof(ConnectionRecord));
+    header.resultCount = static_cast<uint32_t>(results.size());
+    header.resultOffset = alignSection(header.stringOffset + strings.size());
+    
+    // Payloads follow the result table
+    uint64_t dataOffset = header.resultOffset + results.size() * sizeof(ResultRecord);
+    for (ResultRecord& record : results) {
+        record.dataOffset = dataOffset;
+        dataOffset += record.encodedSize;
+    }
+    
+    QByteArray data(static_cast<int>(dataOffset), '\0');
+    char* out = data.data();
+    std::memcpy(out, &header, sizeof(header));
+    std::memcpy(out + header.typeOffset, types.data(), types.size() * sizeof(TypeRecord));
+    std::memcpy(out + header.fieldOffset, fields.data(), fields.size() * sizeof(FieldRecord));
+    std::memcpy(out + header.nodeOffset, nodeRecords.data(), nodeRecords.size() * sizeof(NodeRecord));
+    std::memcpy(out + header.parameterOffset, parameters.data(), parameters.size() * sizeof(ParameterRecord));
+    std::memcpy(out + header.connectionOffset, connectionRecords.data(), connectionRecords.size() * sizeof(ConnectionRecord));
+    std::memcpy(out + header.stringOffset, strings.data(), strings.size());
+    std::memcpy(out + header.resultOffset, results.data(), results.size() * sizeof(ResultRecord));
+    for (size_t i = 0; i < results.size(); i++) {
+        std::memcpy(out + results[i].dataOffset, payloads[i].data(), payloads[i].size());
+    }
+    
+    return data;
 }
 
-void GraphManager::writeConnections(QDataStream& stream) {
-    // Write number of connections
-    stream << quint32(connections_.size());
+bool GraphManager::encodeResult(const cv::Mat& image, bool fullResolution, std::vector<uchar>& encoded) {
+    if (image.empty()) {
+        return false;
+    }
     
-    // Create maps for node and connector lookup
-    std::unordered_map<Node*, int> nodeIndices;
-    for (size_t i = 0; i < nodes_.size(); i++) {
-        nodeIndices[nodes_[i]] = static_cast<int>(i);
+    // PNG is lossless, which cached results need to be reused as node outputs
+    int depth = image.depth();
+    int channels = image.channels();
+    bool encodable = (depth == CV_8U || (fullResolution && depth == CV_16U)) &&
+                     (channels == 1 || channels == 3 || channels == 4);
+    if (!encodable) {
+        return false;
     }
     
-    // Write each connection
-    for (Connection* connection : connections_) {
-        // Get source and destination connectors
-        NodeConnector* source = connection->getSource();
-        NodeConnector* destination = connection->getDestination();
+    try {
+        std::vector<int> params = {cv::IMWRITE_PNG_COMPRESSION, 3};
+        return cv::imencode(".png", image, encoded, params);
+    } catch (const cv::Exception&) {
+        return false;
+    }
+}
+
+bool GraphManager::loadFromFile(const std::string& filePath) {
+    QFile file(QString::fromStdString(filePath));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    
+    // Parse into an empty graph, the current one is set aside until the load succeeds
+    std::vector<Node*> previousNodes;
+    std::vector<Connection*> previousConnections;
+    previousNodes.swap(nodes_);
+    previousConnections.swap(connections_);
+    
+    // Build the whole graph without per-node and per-edge notifications
+    bool loaded = false;
+    {
+        const QSignalBlocker blocker(this);
         
-        // Get parent nodes
-        Node* sourceNode = source->getParentNode();
-        Node* destNode = destination->getParentNode();
+        // Map the file and construct nodes straight from the record tables
+        qint64 size = file.size();
+        uchar* data = size > 0 ? file.map(0, size) : nullptr;
+        if (data && ProjectFormat::hasMagic(data, size)) {
+            loaded = deserializeGraph(data, size);
+        } else {
+            // Fall back to the version 1 stream format
+            loaded = readLegacyGraph(file);
+        }
         
-        // Write source node index
-        stream << qint32(nodeIndices[sourceNode]);
+        if (data) {
+            file.unmap(data);
+        }
+    }
+    
+    file.close();
+    
+    // Validate the loaded graph once instead of per connection
+    if (!loaded || !validateGraph()) {
+        // Drop the partial graph and keep the one that was open
+        for (Connection* connection : connections_) {
+            delete connection;
+        }
+        for (Node* node : nodes_) {
+            delete node;
+        }
+        nodes_.swap(previousNodes);
+        connections_.swap(previousConnections);
+        return false;
+    }
+    
+    // Release the previous graph with the usual deselection notification
+    nodes_.swap(previousNodes);
+    connections_.swap(previousConnections);
+    clear();
+    nodes_.swap(previousNodes);
+    connections_.swap(previousConnections);
+    
+    // Update current file path
+    currentFilePath_ = filePath;
+    
+    // Clear dirty flag
+    dirty_ = false;
+    
+    // Single notification for the whole graph, evaluation is deferred to the event loop
+    emit graphLoaded();
+    scheduleProcessing();
+    
+    return true;
+}
+
+bool GraphManager::deserializeGraph(const uchar* data, qint64 size) {
+    using namespace ProjectFormat;
+    
+    FileHeader header;
+    if (!readHeader(data, size, header)) {
+        return false;
+    }
+    
+    // Check that every table lies inside the file
+    if (!sectionInBounds(header.typeOffset, header.typeCount, sizeof(TypeRecord), size) ||
+        !sectionInBounds(header.fieldOffset, header.fieldCount, sizeof(FieldRecord), size) ||
+        !sectionInBounds(header.nodeOffset, header.nodeCount, sizeof(NodeRecord), size) ||
+        !sectionInBounds(header.parameterOffset, header.parameterCount, sizeof(ParameterRecord), size) ||
+        !sectionInBounds(header.connectionOffset, header.connectionCount, sizeof(ConnectionRecord), size) ||
+        !sectionInBounds(header.stringOffset, header.stringTableSize, 1, size) ||
+        !sectionInBounds(header.resultOffset, header.resultCount, sizeof(ResultRecord), size)) {
+        return false;
+    }
+    
+    const TypeRecord* types = reinterpret_cast<const TypeRecord*>(data + header.typeOffset);
+    const FieldRecord* fields = reinterpret_cast<const FieldRecord*>(data + header.fieldOffset);
+    const NodeRecord* nodeRecords = reinterpret_cast<const NodeRecord*>(data + header.nodeOffset);
+    const ParameterRecord* parameters = reinterpret_cast<const ParameterRecord*>(data + header.parameterOffset);
+    const ConnectionRecord* connectionRecords = reinterpret_cast<const ConnectionRecord*>(data + header.connectionOffset);
+    const char* strings = reinterpret_cast<const char*>(data + header.stringOffset);
+    const ResultRecord* results = reinterpret_cast<const ResultRecord*>(data + header.resultOffset);
+    
+    // The string table must be terminated so every offset yields a valid C string
+    if (header.stringTableSize == 0 || strings[header.stringTableSize - 1] != '\0') {
+        return false;
+    }
+    auto stringAt = [&](uint32_t offset) {
+        return offset < header.stringTableSize ? strings + offset : "";
+    };
+    
+    // Check type schemas against the field table
+    for (uint32_t t = 0; t < header.typeCount; t++) {
+        if (types[t].firstField > header.fieldCount ||
+            types[t].fieldCount > header.fieldCount - types[t].firstField) {
+            return false;
+        }
+    }
+    
+    // Create nodes, unknown types leave a gap so connection indices stay valid
+    NodeRegistry& registry = NodeRegistry::instance();
+    std::vector<Node*> nodesByIndex(header.nodeCount, nullptr);
+    nodes_.reserve(header.nodeCount);
+    
+    for (uint32_t i = 0; i < header.nodeCount; i++) {
+        const NodeRecord& record = nodeRecords[i];
+        if (record.typeIndex >= header.typeCount) {
+            continue;
+        }
         
-        // Write source connector index
-        int sourceIndex = -1;
-        const auto& outputConnectors = sourceNode->getOutputConnectors();
-        for (size_t i = 0; i < outputConnectors.size(); i++) {
-            if (outputConnectors[i] == source) {
-                sourceIndex = static_cast<int>(i);
-                break;
-            }
+        const TypeRecord& type = types[record.typeIndex];
+        if (record.firstParameter > header.parameterCount ||
+            type.fieldCount > header.parameterCount - record.firstParameter) {
+            continue;
         }
-        stream << qint32(sourceIndex);
         
-        // Write destination node index
-        stream << qint32(nodeIndices[destNode]);
+        Node* node = registry.create(stringAt(type.nameOffset));
+        if (!node) {
+            continue;
+        }
         
-        // Write destination connector index
-        int destIndex = -1;
-        const auto& inputConnectors = destNode->getInputConnectors();
-        for (size_t i = 0; i < inputConnectors.size(); i++) {
-            if (inputConnectors[i] == destination) {
-                destIndex = static_cast<int>(i);
-                break;
-            }
+        // Rebuild named parameters from the type schema
+        std::vector<NodeParameter> nodeParameters;
+        nodeParameters.reserve(type.fieldCount);
+        for (uint32_t f = 0; f < type.fieldCount; f++) {
+            const ParameterRecord& value = parameters[record.firstParameter + f];
+            nodeParameters.push_back({stringAt(fields[type.firstField + f].nameOffset), value.value, stringAt(value.textOffset)});
         }
-        stream << qint32(destIndex);
+        node->setParameters(nodeParameters);
+        
+        // Set node properties
+        node->setName(stringAt(record.nameOffset));
+        node->setPosition(QPointF(record.x, record.y));
+        
+        // Add node to graph
+        attachNode(node);
+        nodesByIndex[i] = node;
     }
+    
+    // Create connections from the index table
+    connections_.reserve(header.connectionCount);
+    for (uint32_t i = 0; i < header.connectionCount; i++) {
+        const ConnectionRecord& record = connectionRecords[i];
+        if (record.sourceNode >= header.nodeCount || record.destinationNode >= header.nodeCount) {
+            continue;
+        }
+        
+        Node* sourceNode = nodesByIndex[record.sourceNode];
+        Node* destNode = nodesByIndex[record.destinationNode];
+        if (!sourceNode || !destNode) {
+            continue;
+        }
+        
+        const std::vector<NodeConnector*>& outputConnectors = sourceNode->getOutputConnectors();
+        const std::vector<NodeConnector*>& inputConnectors = destNode->getInputConnectors();
+        if (record.sourcePort >= outputConnectors.size() || record.destinationPort >= inputConnectors.size()) {
+            continue;
+        }
+        
+        // Inputs accept a single connection, drop duplicates from the file
+        NodeConnector* destConnector = inputConnectors[record.destinationPort];
+        if (!destConnector->getConnections().empty()) {
+            continue;
+        }
+        
+        // Create connection, cycles are rejected once the whole graph is read
+        attachConnection(outputConnectors[record.sourcePort], destConnector);
+    }
+    
+    if (header.resultCount > 0) {
+        restoreResults(results, header.resultCount, nodesByIndex, data, size);
+    }
+    
+    return true;
 }
 
-bool GraphManager::loadFromFile(const std::string& filePath) {
-    QFile file(QString::fromStdString(filePath));
-    if (!file.open(QIODevice::ReadOnly)) {
-        return false;
+void GraphManager::restoreResults(const ProjectFormat::ResultRecord* results, uint32_t resultCount,
+                                  const std::vector<Node*>& nodesByIndex, const uchar* data, qint64 size) {
+    using namespace ProjectFormat;
+    
+    // Results are only valid for nodes whose upstream graph is unchanged
+    std::unordered_map<Node*, uint64_t> signatures = computeSignatures();
+    std::unordered_map<Node*, size_t> restoredOutputs;
+    
+    for (uint32_t i = 0; i < resultCount; i++) {
+        const ResultRecord& record = results[i];
+        if (record.nodeIndex >= nodesByIndex.size() || !nodesByIndex[record.nodeIndex]) {
+            continue;
+        }
+        if (record.dataOffset > static_cast<uint64_t>(size) ||
+            record.encodedSize > static_cast<uint64_t>(size) - record.dataOffset) {
+            continue;
+        }
+        
+        Node* node = nodesByIndex[record.nodeIndex];
+        if (record.port >= node->getOutputConnectors().size() || signatures[node] != record.signature) {
+            continue;
+        }
+        
+        // Decode straight from the mapped file
+        cv::Mat image;
+        try {
+            cv::Mat encoded(1, static_cast<int>(record.encodedSize), CV_8U, const_cast<uchar*>(data + record.dataOffset));
+            image = cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+        } catch (const cv::Exception&) {
+            continue;
+        }
+        if (image.empty()) {
+            continue;
+        }
+        
+        if (record.kind == ResultKind::FullResolution) {
+            // Full results become the node's output as if it had been processed
+            node->setOutputImage(image, static_cast<int>(record.port));
+            restoredOutputs[node]++;
+            node->setThumbnail(ImageUtils::toQImage(ImageUtils::makeThumbnail(image, ProjectSaveOptions().thumbnailSize)));
+        } else if (node->getThumbnail().isNull()) {
+            node->setThumbnail(ImageUtils::toQImage(image));
+        }
     }
     
+    // Nodes with every output restored need no processing after the load
+    for (const auto& pair : restoredOutputs) {
+        if (pair.second == pair.first->getOutputConnectors().size()) {
+            pair.first->markClean();
+        }
+    }
+}
+
+bool GraphManager::readLegacyGraph(QFile& file) {
     QDataStream stream(&file);
     stream.setVersion(QDataStream::Qt_5_15);
     
@@ -424,7 +899,6 @@ bool GraphManager::loadFromFile(const std::string& filePath) {
     QString magic;
     stream >> magic;
     if (magic != "NIP") {
-        file.close();
         return false;
     }
     
@@ -432,37 +906,23 @@ bool GraphManager::loadFromFile(const std::string& filePath) {
     quint32 version;
     stream >> version;
     if (version != 1) {
-        file.close();
         return false;
     }
     
-    // Clear current graph
-    clear();
-    
     // Read nodes
     readNodes(stream);
     
     // Read connections
     readConnections(stream);
     
-    file.close();
-    
-    // Process all nodes
-    processAll();
-    
-    // Update current file path
-    currentFilePath_ = filePath;
-    
-    // Clear dirty flag
-    dirty_ = false;
-    
-    return true;
+    return stream.status() == QDataStream::Ok;
 }
 
 void GraphManager::readNodes(QDataStream& stream) {
     // Read number of nodes
     quint32 nodeCount;
     stream >> nodeCount;
+    nodes_.reserve(nodeCount);
     
     // Create a map of node IDs to node pointers
     std::unordered_map<QString, Node*> nodesById;
@@ -529,7 +989,7 @@ void GraphManager::readNodes(QDataStream& stream) {
             node->setPosition(position);
             
             // Add node to graph
-            addNode(node);
+            attachNode(node);
             
             // Add to map
             nodesById[nodeId] = node;
@@ -541,6 +1001,7 @@ void GraphManager::readConnections(QDataStream& stream) {
     // Read number of connections
     quint32 connectionCount;
     stream >> connectionCount;
+    connections_.reserve(connectionCount);
     
     // Read each connection
     for (quint32 i = 0; i < connectionCount; i++) {
@@ -580,11 +1041,28 @@ void GraphManager::readConnections(QDataStream& stream) {
         NodeConnector* sourceConnector = sourceNode->getOutputConnectors()[sourceConnectorIndex];
         NodeConnector* destConnector = destNode->getInputConnectors()[destConnectorIndex];
         
-        // Create connection
-        connect(sourceConnector, destConnector);
+        // Inputs accept a single connection, drop duplicates from the file
+        if (!destConnector->getConnections().empty()) {
+            continue;
+        }
+        
+        // Create connection, cycles are rejected once the whole graph is read
+        attachConnection(sourceConnector, destConnector);
     }
 }
 
+bool GraphManager::validateGraph() {
+    // Connections must link an output to an input of two different nodes
+    for (Connection* connection : connections_) {
+        if (connection->getSource()->getParentNode() == connection->getDestination()->getParentNode()) {
+            return false;
+        }
+    }
+    
+    // A topological order that misses nodes means the graph contains a cycle
+    return calculateProcessingOrder().size() == nodes_.size();
+}
+
 void GraphManager::clear() {
     // Clear selection
     selectNode(nullptr);
@@ -606,6 +1084,177 @@ void GraphManager::clear() {
     
     // Reset dirty flag
     dirty_ = false;
+    
+    // Autosave belongs to the project that was open
+    journal_.reset();
+    journaledSettings_.clear();
+}
+
+void GraphManager::enableAutosave(const std::string& basePath) {
+    journal_.reset(new ProjectJournal(basePath + ".autosave", basePath + ".journal"));
+    
+    // Start from a snapshot of the current graph
+    compactJournal(true);
+}
+
+void GraphManager::disableAutosave() {
+    journal_.reset();
+    journaledSettings_.clear();
+}
+
+bool GraphManager::isAutosaveEnabled() const {
+    return journal_ != nullptr;
+}
+
+bool GraphManager::hasAutosave(const std::string& basePath) {
+    // Only a journal with edits past its snapshot holds unsaved work
+    uint64_t snapshotHash;
+    std::vector<int> nodeIds;
+    std::vector<ProjectJournal::Entry> entries;
+    return ProjectJournal::readJournal(basePath + ".journal", snapshotHash, nodeIds, entries) && !entries.empty();
+}
+
+bool GraphManager::recoverAutosave(const std::string& basePath) {
+    uint64_t snapshotHash;
+    std::vector<int> nodeIds;
+    std::vector<ProjectJournal::Entry> entries;
+    if (!ProjectJournal::readJournal(basePath + ".journal", snapshotHash, nodeIds, entries)) {
+        return false;
+    }
+    
+    // The snapshot is swapped in before its journal is restarted, so a crash in
+    // between leaves a journal from an earlier snapshot. The newer snapshot
+    // already holds those edits, replaying them would apply them twice.
+    QFile snapshotFile(QString::fromStdString(basePath + ".autosave"));
+    if (!snapshotFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    bool matched = ProjectJournal::hashSnapshot(snapshotFile.readAll()) == snapshotHash;
+    snapshotFile.close();
+    if (!matched) {
+        entries.clear();
+        nodeIds.clear();
+    }
+    
+    // Load the snapshot the journal was started from
+    if (!loadFromFile(basePath + ".autosave") || (matched && nodes_.size() != nodeIds.size())) {
+        return false;
+    }
+    
+    // Journal entries refer to node ids from the session that wrote them
+    std::unordered_map<int, Node*> nodesById;
+    for (size_t i = 0; i < nodeIds.size(); i++) {
+        nodesById[nodeIds[i]] = nodes_[i];
+    }
+    
+    auto findConnector = [&nodesById](int nodeId, int port, bool output) -> NodeConnector* {
+        auto it = nodesById.find(nodeId);
+        if (it == nodesById.end()) return nullptr;
+        
+        const auto& connectors = output ? it->second->getOutputConnectors() : it->second->getInputConnectors();
+        if (port < 0 || port >= static_cast<int>(connectors.size())) return nullptr;
+        return connectors[port];
+    };
+    
+    // Replay the edits, entries that no longer apply are skipped
+    {
+        const QSignalBlocker blocker(this);
+        
+        for (const ProjectJournal::Entry& entry : entries) {
+            switch (entry.type) {
+                case ProjectJournal::EntryType::NodeAdded: {
+                    Node* node = NodeRegistry::instance().create(entry.typeName);
+                    if (!node) break;
+                    node->setPosition(entry.position);
+                    node->setParameters(entry.parameters);
+                    addNode(node);
+                    nodesById[entry.nodeId] = node;
+                    break;
+                }
+                case ProjectJournal::EntryType::NodeRemoved: {
+                    auto it = nodesById.find(entry.nodeId);
+                    if (it == nodesById.end()) break;
+                    removeNode(it->second);
+                    nodesById.erase(it);
+                    break;
+                }
+                case ProjectJournal::EntryType::ConnectionAdded: {
+                    NodeConnector* source = findConnector(entry.sourceId, entry.sourcePort, true);
+                    NodeConnector* destination = findConnector(entry.destinationId, entry.destinationPort, false);
+                    if (source && destination && canConnect(source, destination)) {
+                        connect(source, destination);
+                    }
+                    break;
+                }
+                case ProjectJournal::EntryType::ConnectionRemoved: {
+                    NodeConnector* source = findConnector(entry.sourceId, entry.sourcePort, true);
+                    NodeConnector* destination = findConnector(entry.destinationId, entry.destinationPort, false);
+                    for (Connection* connection : connections_) {
+                        if (connection->getSource() == source && connection->getDestination() == destination) {
+                            disconnect(connection);
+                            break;
+                        }
+                    }
+                    break;
+                }
+                case ProjectJournal::EntryType::ParametersSet: {
+                    auto it = nodesById.find(entry.nodeId);
+                    if (it != nodesById.end()) {
+                        it->second->setParameters(entry.parameters);
+                        it->second->markDirty();
+                    }
+                    break;
+                }
+            }
+        }
+    }
+    
+    // The recovered graph belongs to the project file but is not saved in it
+    currentFilePath_ = basePath;
+    dirty_ = true;
+    
+    emit graphLoaded();
+    scheduleProcessing();
+    
+    // Continue journaling from the recovered state
+    enableAutosave(basePath);
+    
+    return true;
+}
+
+void GraphManager::compactJournal(bool force) {
+    if (!journal_) return;
+    if (!force && journal_->getEntriesSinceSnapshot() < kJournalCompactionInterval) return;
+    
+    // Snapshot node order is the order used by serializeGraph
+    std::vector<int> nodeIds;
+    nodeIds.reserve(nodes_.size());
+    journaledSettings_.clear();
+    for (Node* node : nodes_) {
+        nodeIds.push_back(node->getId());
+        journaledSettings_[node] = hashNodeSettings(node);
+    }
+    journal_->compact(serializeGraph(), nodeIds);
+}
+
+void GraphManager::journalParameters(Node* node, uint64_t settings) {
+    if (!journal_) return;
+    
+    // Only settings that differ from the snapshot or the last entry are written
+    auto it = journaledSettings_.find(node);
+    if (it != journaledSettings_.end() && it->second == settings) return;
+    
+    journaledSettings_[node] = settings;
+    journal_->recordParameters(node->getId(), node->getParameters());
+    compactJournal();
+}
+
+void GraphManager::journalConnection(ProjectJournal::EntryType type, NodeConnector* source, NodeConnector* destination) {
+    if (!journal_) return;
+    
+    journal_->recordConnection(type, source->getParentNode()->getId(), source->getIndex(),
+                               destination->getParentNode()->getId(), destination->getIndex());
+    compactJournal();
 }
 
 const std::string& GraphManager::getCurrentFilePath() const {
@@ -1,10 +1,23 @@
 #pragma once
 
 #include <QObject>
+#include <QByteArray>
+#include <QFile>
 #include <vector>
 #include <string>
+#include <unordered_map>
+#include <memory>
 #include "Node.h"
 #include "Connection.h"
+#include "ProjectFormat.h"
+#include "ProjectJournal.h"
+
+// Options for saving a project file
+struct ProjectSaveOptions {
+    bool embedResults = false;              // Store cached node outputs in the file
+    std::vector<Node*> fullResolutionNodes; // Stored at full resolution, other nodes as thumbnails
+    int thumbnailSize = 128;
+};
 
 class GraphManager : public QObject {
     Q_OBJECT
@@ -28,12 +41,20 @@ public:
     
     // Processing
     void processAll();
+    void scheduleProcessing();
     
     // Project file I/O
-    bool saveToFile(const std::string& filePath);
+    bool saveToFile(const std::string& filePath, const ProjectSaveOptions& options = ProjectSaveOptions());
     bool loadFromFile(const std::string& filePath);
     void clear();
     
+    // Journaled autosave next to basePath (basePath.autosave and basePath.journal)
+    void enableAutosave(const std::string& basePath);
+    void disableAutosave();
+    bool isAutosaveEnabled() const;
+    static bool hasAutosave(const std::string& basePath);
+    bool recoverAutosave(const std::string& basePath);
+    
     // Current file path
     const std::string& getCurrentFilePath() const;
     
@@ -47,6 +68,7 @@ signals:
     void nodeRemoved(Node* node);
     void connectionAdded(Connection* connection);
     void connectionRemoved(Connection* connection);
+    void graphLoaded();
     
 private:
     std::vector<Node*> nodes_;
@@ -54,13 +76,37 @@ private:
     Node* selectedNode_;
     std::string currentFilePath_;
     bool dirty_;
+    bool processingScheduled_;
+    std::unique_ptr<ProjectJournal> journal_;
+    
+    // Settings hash of each node as of the snapshot or its last journal entry
+    std::unordered_map<Node*, uint64_t> journaledSettings_;
     
     // Node processing order calculation
-    std::vector<Node*> calculateProcessingOrder();
+    std::vector<Node*> calculateProcessingOrder() const;
+    
+    // Hash of each node's type, parameters and upstream graph, used to key cached results
+    std::unordered_map<Node*, uint64_t> computeSignatures() const;
+    
+    // Graph construction without notifications, shared by the interactive and bulk paths
+    void attachNode(Node* node);
+    Connection* attachConnection(NodeConnector* source, NodeConnector* destination);
+    bool validateGraph();
+    
+    // Autosave helpers, compaction runs once enough entries have accumulated unless forced
+    void compactJournal(bool force = false);
+    void journalConnection(ProjectJournal::EntryType type, NodeConnector* source, NodeConnector* destination);
+    void journalParameters(Node* node, uint64_t settings);
+    
+    // Helpers for loading/saving the binary project format
+    QByteArray serializeGraph(const ProjectSaveOptions& options = ProjectSaveOptions()) const;
+    bool deserializeGraph(const uchar* data, qint64 size);
+    static bool encodeResult(const cv::Mat& image, bool fullResolution, std::vector<uchar>& encoded);
+    void restoreResults(const ProjectFormat::ResultRecord* results, uint32_t resultCount,
+                        const std::vector<Node*>& nodesByIndex, const uchar* data, qint64 size);
     
-    // Helper for loading/saving
-    void writeNodes(QDataStream& stream);
+    // Helpers for loading legacy version 1 project files
+    bool readLegacyGraph(QFile& file);
     void readNodes(QDataStream& stream);
-    void writeConnections(QDataStream& stream);
     void readConnections(QDataStream& stream);
 };
\ No newline at end of file
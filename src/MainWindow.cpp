@@ -2,14 +2,12 @@
 #include "nodes/InputNode.h"
 #include "nodes/OutputNode.h"
 #include "nodes/BrightnessContrastNode.h"
+#include "connections/NodeConnector.h"
 
 #include <QVBoxLayout>
 #include <QApplication>
 #include <QStandardPaths>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QFile>
+#include <QFileInfo>
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent), currentProjectFile_("") {
@@ -66,6 +64,11 @@ void MainWindow::createMenu() {
     connect(saveProjectAsAction_, &QAction::triggered, this, &MainWindow::saveProjectAs);
     fileMenu->addAction(saveProjectAsAction_);
     
+    embedResultsAction_ = new QAction("Embed Cached &Results", this);
+    embedResultsAction_->setCheckable(true);
+    embedResultsAction_->setChecked(false);
+    fileMenu->addAction(embedResultsAction_);
+    
     fileMenu->addSeparator();
     
     exitAction_ = new QAction("E&xit", this);
@@ -192,31 +195,29 @@ void MainWindow::openProject() {
         return;
     }
     
-    // Open the file
-    QFile file(fileName);
-    if (!file.open(QIODevice::ReadOnly)) {
-        QMessageBox::warning(this, "Error", "Could not open file: " + file.errorString());
-        return;
-    }
-    
-    // Read the JSON data
-    QByteArray data = file.readAll();
-    QJsonDocument doc = QJsonDocument::fromJson(data);
+    // Load the project, evaluation of the graph is deferred by the graph manager
+    bool success = graphManager_->loadFromFile(fileName.toStdString());
     
-    if (doc.isNull()) {
-        QMessageBox::warning(this, "Error", "Invalid project file format");
+    if (!success) {
+        QMessageBox::warning(this, "Error", "Failed to load project");
         return;
     }
     
-    // Clear existing graph
-    graphManager_->clear();
-    
-    // Load the project from JSON
-    bool success = graphManager_->loadFromJson(doc.object());
+    // Offer to restore edits that were journaled but never saved
+    if (GraphManager::hasAutosave(fileName.toStdString())) {
+        QMessageBox::StandardButton reply = QMessageBox::question(
+            this, "Recover Project", "This project has unsaved changes from a previous session. Recover them?",
+            QMessageBox::Yes | QMessageBox::No);
+            
+        if (reply == QMessageBox::Yes && !graphManager_->recoverAutosave(fileName.toStdString())) {
+            QMessageBox::warning(this, "Error", "Failed to recover unsaved changes");
+            graphManager_->loadFromFile(fileName.toStdString());
+        }
+    }
     
-    if (!success) {
-        QMessageBox::warning(this, "Error", "Failed to load project");
-        return;
+    // Journal further edits next to the project file
+    if (!graphManager_->isAutosaveEnabled()) {
+        graphManager_->enableAutosave(fileName.toStdString());
     }
     
     // Set current project file
@@ -236,19 +237,36 @@ void MainWindow::saveProject() {
         return;
     }
     
-    // Get JSON representation of the graph
-    QJsonObject json;
-    graphManager_->saveToJson(json);
-    QJsonDocument doc(json);
+    // Optionally embed results: full resolution for the selected node and the
+    // nodes feeding outputs, thumbnails for everything else
+    ProjectSaveOptions options;
+    options.embedResults = embedResultsAction_->isChecked();
+    if (options.embedResults) {
+        if (graphManager_->getSelectedNode()) {
+            options.fullResolutionNodes.push_back(graphManager_->getSelectedNode());
+        }
+        for (Node* node : graphManager_->getNodes()) {
+            if (node->getType() != NodeType::Output) {
+                continue;
+            }
+            for (NodeConnector* input : node->getInputConnectors()) {
+                for (Connection* connection : input->getConnections()) {
+                    options.fullResolutionNodes.push_back(connection->getSource()->getParentNode());
+                }
+            }
+        }
+    }
     
-    // Write to file
-    QFile file(currentProjectFile_);
-    if (!file.open(QIODevice::WriteOnly)) {
-        QMessageBox::warning(this, "Error", "Could not save file: " + file.errorString());
+    // Write the graph in the binary project format
+    if (!graphManager_->saveToFile(currentProjectFile_.toStdString(), options)) {
+        QMessageBox::warning(this, "Error", "Could not save file: " + currentProjectFile_);
         return;
     }
     
-    file.write(doc.toJson());
+    // Journal further edits next to the project file
+    if (!graphManager_->isAutosaveEnabled()) {
+        graphManager_->enableAutosave(currentProjectFile_.toStdString());
+    }
     
     // Update status bar
     statusBar()->showMessage("Project saved: " + currentProjectFile_, 3000);
@@ -270,7 +288,10 @@ void MainWindow::saveProjectAs() {
         fileName += ".niproj";
     }
     
-    // Set current project file
+    // Set current project file, the autosave moves with it
+    if (fileName != currentProjectFile_) {
+        graphManager_->disableAutosave();
+    }
     currentProjectFile_ = fileName;
     
     // Call save project
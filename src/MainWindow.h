@@ -108,6 +108,7 @@ private:
     QAction* openProjectAction_;
     QAction* saveProjectAction_;
     QAction* saveProjectAsAction_;
+    QAction* embedResultsAction_;
     QAction* exitAction_;
     
     // Node menu actions
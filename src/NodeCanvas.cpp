@@ -32,6 +32,7 @@ NodeCanvas::NodeCanvas(GraphManager* graphManager, QWidget* parent)
     connect(graphManager_, &GraphManager::nodeRemoved, this, QOverload<>::of(&QWidget::update));
     connect(graphManager_, &GraphManager::connectionAdded, this, QOverload<>::of(&QWidget::update));
     connect(graphManager_, &GraphManager::connectionRemoved, this, QOverload<>::of(&QWidget::update));
+    connect(graphManager_, &GraphManager::graphLoaded, this, QOverload<>::of(&QWidget::update));
 }
 
 NodeCanvas::~NodeCanvas() {
@@ -134,6 +135,15 @@ void NodeCanvas::drawNodes(QPainter& painter) {
         painter.setPen(Qt::white);
         painter.drawText(titleRect, Qt::AlignCenter, QString::fromStdString(node->getName()));
         
+        // Draw embedded preview in the node body until the node is processed
+        const QImage& thumbnail = node->getThumbnail();
+        if (!thumbnail.isNull()) {
+            QRect previewRect = nodeRect.adjusted(NODE_WIDTH / 4, TITLE_HEIGHT + 4, -NODE_WIDTH / 4, -4);
+            QRect targetRect(QPoint(0, 0), thumbnail.size().scaled(previewRect.size(), Qt::KeepAspectRatio));
+            targetRect.moveCenter(previewRect.center());
+            painter.drawImage(targetRect, thumbnail);
+        }
+        
         // Draw connectors
         // Input connectors on the left
         const auto& inputConnectors = node->getInputConnectors();
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Binary project file layout (version 3)
+//
+//   FileHeader
+//   TypeRecord[typeCount]              node types used by the project
+//   FieldRecord[fieldCount]            parameter schema of each type
+//   NodeRecord[nodeCount]
+//   ParameterRecord[parameterCount]    values in schema order, per node
+//   ConnectionRecord[connectionCount]  index table into the node records
+//   char strings[stringTableSize]      NUL-terminated UTF-8, offset 0 is ""
+//   ResultRecord[resultCount]          optional embedded node outputs
+//   encoded image data                 PNG payloads referenced by the results
+//
+// Version 2 files use the same layout without the result fields in the header.
+//
+// Records are stored in native little-endian layout and every section starts
+// on an 8-byte boundary, so a memory-mapped file can be read in place.
+namespace ProjectFormat {
+
+const char kMagic[4] = {'N', 'I', 'P', '2'};
+const uint32_t kVersion = 3;
+const uint32_t kMinimumVersion = 2;
+const uint32_t kSectionAlignment = 8;
+
+struct FileHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t typeCount;
+    uint32_t fieldCount;
+    uint32_t nodeCount;
+    uint32_t parameterCount;
+    uint32_t connectionCount;
+    uint32_t stringTableSize;
+    uint64_t typeOffset;
+    uint64_t fieldOffset;
+    uint64_t nodeOffset;
+    uint64_t parameterOffset;
+    uint64_t connectionOffset;
+    uint64_t stringOffset;
+    uint32_t resultCount;
+    uint32_t reserved;
+    uint64_t resultOffset;
+};
+
+// Size of the header as written by a given file version
+const uint32_t kVersion2HeaderSize = 80;
+
+struct TypeRecord {
+    uint32_t nameOffset;
+    uint32_t firstField;
+    uint32_t fieldCount;
+    uint32_t reserved;
+};
+
+struct FieldRecord {
+    uint32_t nameOffset;
+    uint32_t reserved;
+};
+
+struct NodeRecord {
+    uint32_t typeIndex;
+    uint32_t nameOffset;
+    float x;
+    float y;
+    uint32_t firstParameter; // Parameter count is the type's field count
+    uint32_t reserved;
+};
+
+struct ParameterRecord {
+    double value;
+    uint32_t textOffset;
+    uint32_t reserved;
+};
+
+enum class ResultKind : uint32_t {
+    FullResolution,
+    Thumbnail
+};
+
+// Encoded output of a node, valid while the node's upstream signature matches
+struct ResultRecord {
+    uint64_t signature;
+    uint32_t nodeIndex;
+    uint32_t port;
+    ResultKind kind;
+    uint32_t encodedSize;
+    uint64_t dataOffset;
+};
+
+struct ConnectionRecord {
+    uint32_t sourceNode;
+    uint32_t destinationNode;
+    uint16_t sourcePort;
+    uint16_t destinationPort;
+};
+
+static_assert(sizeof(FileHeader) == 96, "FileHeader layout must not change");
+static_assert(sizeof(TypeRecord) == 16, "TypeRecord layout must not change");
+static_assert(sizeof(FieldRecord) == 8, "FieldRecord layout must not change");
+static_assert(sizeof(NodeRecord) == 24, "NodeRecord layout must not change");
+static_assert(sizeof(ParameterRecord) == 16, "ParameterRecord layout must not change");
+static_assert(sizeof(ConnectionRecord) == 12, "ConnectionRecord layout must not change");
+static_assert(sizeof(ResultRecord) == 32, "ResultRecord layout must not change");
+
+inline bool hasMagic(const unsigned char* data, int64_t size) {
+    return size >= static_cast<int64_t>(kVersion2HeaderSize) && std::memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+inline uint64_t alignSection(uint64_t offset) {
+    return (offset + kSectionAlignment - 1) & ~static_cast<uint64_t>(kSectionAlignment - 1);
+}
+
+// Read the header of a mapped file, fields missing from older versions are zeroed
+inline bool readHeader(const unsigned char* data, int64_t size, FileHeader& header) {
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(&header, data, kVersion2HeaderSize);
+    if (header.version < kMinimumVersion || header.version > kVersion) {
+        return false;
+    }
+
+    if (header.version >= 3) {
+        if (size < static_cast<int64_t>(sizeof(FileHeader))) {
+            return false;
+        }
+        std::memcpy(&header, data, sizeof(FileHeader));
+    }
+    return true;
+}
+
+// Check that a table of count records at offset lies inside the file
+inline bool sectionInBounds(uint64_t offset, uint64_t count, uint64_t recordSize, int64_t fileSize) {
+    if (offset % kSectionAlignment != 0 || offset > static_cast<uint64_t>(fileSize)) {
+        return false;
+    }
+    return count <= (static_cast<uint64_t>(fileSize) - offset) / recordSize;
+}
+
+} // namespace ProjectFormat
@@ -0,0 +1,313 @@
+#include "ProjectJournal.h"
+#include "utils/ImageUtils.h"
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+const char kJournalMagic[4] = {'N', 'I', 'P', 'J'};
+const uint32_t kJournalVersion = 2;
+
+template <typename T>
+void appendValue(QByteArray& buffer, T value) {
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendString(QByteArray& buffer, const std::string& text) {
+    appendValue(buffer, static_cast<uint32_t>(text.size()));
+    buffer.append(text.data(), static_cast<int>(text.size()));
+}
+
+void appendParameters(QByteArray& buffer, const std::vector<NodeParameter>& parameters) {
+    appendValue(buffer, static_cast<uint32_t>(parameters.size()));
+    for (const NodeParameter& parameter : parameters) {
+        appendString(buffer, parameter.name);
+        appendValue(buffer, parameter.value);
+        appendString(buffer, parameter.text);
+    }
+}
+
+// Frame an entry as [payload size][type][payload]
+QByteArray beginEntry(ProjectJournal::EntryType type) {
+    QByteArray buffer;
+    buffer.reserve(64);
+    appendValue(buffer, uint32_t(0));
+    appendValue(buffer, static_cast<uint8_t>(type));
+    return buffer;
+}
+
+void endEntry(QByteArray& buffer) {
+    uint32_t payloadSize = static_cast<uint32_t>(buffer.size() - sizeof(uint32_t));
+    std::memcpy(buffer.data(), &payloadSize, sizeof(payloadSize));
+}
+
+// Bounds-checked reader over a journal buffer
+class Reader {
+public:
+    Reader(const char* data, size_t size) : data_(data), size_(size), offset_(0) {}
+
+    template <typename T>
+    bool read(T& value) {
+        if (size_ - offset_ < sizeof(T)) return false;
+        std::memcpy(&value, data_ + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& text) {
+        uint32_t length;
+        if (!read(length) || size_ - offset_ < length) return false;
+        text.assign(data_ + offset_, length);
+        offset_ += length;
+        return true;
+    }
+
+    bool readParameters(std::vector<NodeParameter>& parameters) {
+        uint32_t count;
+        if (!read(count)) return false;
+        parameters.clear();
+        for (uint32_t i = 0; i < count; i++) {
+            NodeParameter parameter;
+            if (!readString(parameter.name) || !read(parameter.value) || !readString(parameter.text)) {
+                return false;
+            }
+            parameters.push_back(std::move(parameter));
+        }
+        return true;
+    }
+
+    size_t remaining() const { return size_ - offset_; }
+    const char* current() const { return data_ + offset_; }
+    void skip(size_t bytes) { offset_ += bytes; }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t offset_;
+};
+
+} // namespace
+
+ProjectJournal::ProjectJournal(const std::string& snapshotPath, const std::string& journalPath)
+    : snapshotPath_(snapshotPath),
+      journalPath_(journalPath),
+      entriesSinceSnapshot_(0),
+      pending_(0),
+      stopping_(false) {
+    worker_ = std::thread(&ProjectJournal::run, this);
+}
+
+ProjectJournal::~ProjectJournal() {
+    // Finish queued writes before the files are closed
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    workAvailable_.notify_one();
+    worker_.join();
+}
+
+void ProjectJournal::recordNodeAdded(int nodeId, const std::string& typeName, const QPointF& position,
+                                     const std::vector<NodeParameter>& parameters) {
+    QByteArray entry = beginEntry(EntryType::NodeAdded);
+    appendValue(entry, static_cast<int32_t>(nodeId));
+    appendString(entry, typeName);
+    appendValue(entry, static_cast<float>(position.x()));
+    appendValue(entry, static_cast<float>(position.y()));
+    appendParameters(entry, parameters);
+    endEntry(entry);
+    enqueue({false, QByteArray(), entry});
+}
+
+void ProjectJournal::recordNodeRemoved(int nodeId) {
+    QByteArray entry = beginEntry(EntryType::NodeRemoved);
+    appendValue(entry, static_cast<int32_t>(nodeId));
+    endEntry(entry);
+    enqueue({false, QByteArray(), entry});
+}
+
+void ProjectJournal::recordConnection(EntryType type, int sourceId, int sourcePort, int destinationId, int destinationPort) {
+    QByteArray entry = beginEntry(type);
+    appendValue(entry, static_cast<int32_t>(sourceId));
+    appendValue(entry, static_cast<uint16_t>(sourcePort));
+    appendValue(entry, static_cast<int32_t>(destinationId));
+    appendValue(entry, static_cast<uint16_t>(destinationPort));
+    endEntry(entry);
+    enqueue({false, QByteArray(), entry});
+}
+
+void ProjectJournal::recordParameters(int nodeId, const std::vector<NodeParameter>& parameters) {
+    QByteArray entry = beginEntry(EntryType::ParametersSet);
+    appendValue(entry, static_cast<int32_t>(nodeId));
+    appendParameters(entry, parameters);
+    endEntry(entry);
+    enqueue({false, QByteArray(), entry});
+}
+
+void ProjectJournal::compact(const QByteArray& snapshot, const std::vector<int>& nodeIds) {
+    // Header of the restarted journal names its snapshot and maps snapshot node indices to node ids
+    QByteArray header;
+    header.append(kJournalMagic, sizeof(kJournalMagic));
+    appendValue(header, kJournalVersion);
+    appendValue(header, hashSnapshot(snapshot));
+    appendValue(header, static_cast<uint32_t>(nodeIds.size()));
+    for (int nodeId : nodeIds) {
+        appendValue(header, static_cast<int32_t>(nodeId));
+    }
+
+    enqueue({true, snapshot, header});
+    entriesSinceSnapshot_ = 0;
+}
+
+void ProjectJournal::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    workDone_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+void ProjectJournal::enqueue(Task task) {
+    if (!task.snapshot) {
+        entriesSinceSnapshot_++;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(task));
+        pending_++;
+    }
+    workAvailable_.notify_one();
+}
+
+void ProjectJournal::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        workAvailable_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+        if (queue_.empty()) {
+            break;
+        }
+
+        // Take the whole batch so callers are never blocked by file I/O
+        std::deque<Task> tasks;
+        tasks.swap(queue_);
+        lock.unlock();
+
+        for (const Task& task : tasks) {
+            if (task.snapshot) {
+                writeSnapshot(task.snapshotData, task.data);
+            } else if (journalFile_.is_open()) {
+                journalFile_.write(task.data.constData(), task.data.size());
+            }
+        }
+        journalFile_.flush();
+
+        lock.lock();
+        pending_ -= tasks.size();
+        workDone_.notify_all();
+    }
+}
+
+void ProjectJournal::writeSnapshot(const QByteArray& snapshotData, const QByteArray& journalHeader) {
+    // Write the snapshot next to the old one and swap it in
+    std::string temporaryPath = snapshotPath_ + ".tmp";
+    {
+        std::ofstream snapshotFile(temporaryPath, std::ios::binary | std::ios::trunc);
+        snapshotFile.write(snapshotData.constData(), snapshotData.size());
+        if (!snapshotFile) {
+            return;
+        }
+    }
+    if (std::rename(temporaryPath.c_str(), snapshotPath_.c_str()) != 0) {
+        // Platforms that refuse to replace an existing file on rename
+        std::remove(snapshotPath_.c_str());
+        if (std::rename(temporaryPath.c_str(), snapshotPath_.c_str()) != 0) {
+            return;
+        }
+    }
+
+    // Restart the journal from the new snapshot
+    journalFile_.close();
+    journalFile_.open(journalPath_, std::ios::binary | std::ios::trunc);
+    journalFile_.write(journalHeader.constData(), journalHeader.size());
+}
+
+uint64_t ProjectJournal::hashSnapshot(const QByteArray& snapshot) {
+    return ImageUtils::hashBytes(snapshot.constData(), static_cast<size_t>(snapshot.size()));
+}
+
+bool ProjectJournal::readJournal(const std::string& journalPath, uint64_t& snapshotHash,
+                                 std::vector<int>& nodeIds, std::vector<Entry>& entries) {
+    std::ifstream file(journalPath, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Header
+    Reader reader(data.data(), data.size());
+    char magic[4];
+    uint32_t version;
+    uint32_t nodeCount;
+    if (!reader.read(magic) || std::memcmp(magic, kJournalMagic, sizeof(magic)) != 0 ||
+        !reader.read(version) || version != kJournalVersion || !reader.read(snapshotHash) || !reader.read(nodeCount)) {
+        return false;
+    }
+
+    nodeIds.clear();
+    for (uint32_t i = 0; i < nodeCount; i++) {
+        int32_t nodeId;
+        if (!reader.read(nodeId)) return false;
+        nodeIds.push_back(nodeId);
+    }
+
+    // Entries, stopping at a partially written tail
+    entries.clear();
+    uint32_t payloadSize;
+    while (reader.read(payloadSize) && payloadSize <= reader.remaining()) {
+        Reader payload(reader.current(), payloadSize);
+        reader.skip(payloadSize);
+
+        Entry entry = {};
+        uint8_t type;
+        if (!payload.read(type)) break;
+        entry.type = static_cast<EntryType>(type);
+
+        bool valid = false;
+        int32_t nodeId = 0;
+        switch (entry.type) {
+            case EntryType::NodeAdded: {
+                float x = 0.0f;
+                float y = 0.0f;
+                valid = payload.read(nodeId) && payload.readString(entry.typeName) &&
+                        payload.read(x) && payload.read(y) && payload.readParameters(entry.parameters);
+                entry.position = QPointF(x, y);
+                break;
+            }
+            case EntryType::NodeRemoved:
+                valid = payload.read(nodeId);
+                break;
+            case EntryType::ConnectionAdded:
+            case EntryType::ConnectionRemoved: {
+                int32_t sourceId = 0;
+                int32_t destinationId = 0;
+                uint16_t sourcePort = 0;
+                uint16_t destinationPort = 0;
+                valid = payload.read(sourceId) && payload.read(sourcePort) &&
+                        payload.read(destinationId) && payload.read(destinationPort);
+                entry.sourceId = sourceId;
+                entry.sourcePort = sourcePort;
+                entry.destinationId = destinationId;
+                entry.destinationPort = destinationPort;
+                break;
+            }
+            case EntryType::ParametersSet:
+                valid = payload.read(nodeId) && payload.readParameters(entry.parameters);
+                break;
+        }
+
+        if (!valid) break;
+        entry.nodeId = nodeId;
+        entries.push_back(std::move(entry));
+    }
+
+    return true;
+}
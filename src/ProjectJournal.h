@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QByteArray>
+#include <QPointF>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "nodes/Node.h"
+
+// ProjectJournal - Append-only edit log used for autosave
+//
+// Edits are encoded on the caller's thread and queued; a background thread
+// appends them to the journal file. compact() replaces the snapshot with a
+// full project file and restarts the journal from it, so recovery loads the
+// snapshot and replays the journal on top. The journal header carries a hash
+// of its snapshot so a pair torn by a crash mid-compaction is detected.
+class ProjectJournal {
+public:
+    enum class EntryType : uint8_t {
+        NodeAdded = 1,
+        NodeRemoved,
+        ConnectionAdded,
+        ConnectionRemoved,
+        ParametersSet
+    };
+
+    // Decoded journal entry, fields not used by the entry type are left empty
+    struct Entry {
+        EntryType type;
+        int nodeId;
+        std::string typeName;
+        QPointF position;
+        std::vector<NodeParameter> parameters;
+        int sourceId;
+        int sourcePort;
+        int destinationId;
+        int destinationPort;
+    };
+
+    ProjectJournal(const std::string& snapshotPath, const std::string& journalPath);
+    ~ProjectJournal();
+
+    // Record edits, only the encoding happens on the calling thread
+    void recordNodeAdded(int nodeId, const std::string& typeName, const QPointF& position,
+                         const std::vector<NodeParameter>& parameters);
+    void recordNodeRemoved(int nodeId);
+    void recordConnection(EntryType type, int sourceId, int sourcePort, int destinationId, int destinationPort);
+    void recordParameters(int nodeId, const std::vector<NodeParameter>& parameters);
+
+    // Replace the snapshot and restart the journal, nodeIds gives the id of each snapshot node
+    void compact(const QByteArray& snapshot, const std::vector<int>& nodeIds);
+
+    // Block until every queued write has reached the files
+    void flush();
+
+    size_t getEntriesSinceSnapshot() const { return entriesSinceSnapshot_; }
+    const std::string& getSnapshotPath() const { return snapshotPath_; }
+
+    // Read a journal for recovery, a truncated final entry is ignored
+    static bool readJournal(const std::string& journalPath, uint64_t& snapshotHash,
+                            std::vector<int>& nodeIds, std::vector<Entry>& entries);
+
+    // Hash stored in the header of the journal started from snapshot
+    static uint64_t hashSnapshot(const QByteArray& snapshot);
+
+private:
+    // Journal bytes to append, or a snapshot plus the header of the restarted journal
+    struct Task {
+        bool snapshot;
+        QByteArray snapshotData;
+        QByteArray data;
+    };
+
+    std::string snapshotPath_;
+    std::string journalPath_;
+    std::ofstream journalFile_;
+    size_t entriesSinceSnapshot_;
+
+    // Worker state, guarded by mutex_
+    std::thread worker_;
+    std::mutex mutex_;
+    std::condition_variable workAvailable_;
+    std::condition_variable workDone_;
+    std::deque<Task> queue_;
+    size_t pending_;
+    bool stopping_;
+
+    void enqueue(Task task);
+    void run();
+    void writeSnapshot(const QByteArray& snapshotData, const QByteArray& journalHeader);
+};
@@ -1,13 +1,42 @@
 #include "BlendNode.h"
+#include "../utils/ImageUtils.h"
+#include "../utils/ParallelUtils.h"
+
+namespace {
+
+// Straight-alpha copy of a premultiplied BGRA image, other images are returned as is
+cv::Mat unpremultiply(const cv::Mat& image) {
+    if (image.type() != CV_8UC4) {
+        return image;
+    }
+
+    cv::Mat straight(image.size(), image.type());
+    for (int y = 0; y < image.rows; y++) {
+        BlendKernels::unpremultiplyRow(image.ptr(y), straight.ptr(y), image.cols);
+    }
+    return straight;
+}
+
+} // namespace
 
 BlendNode::BlendNode()
     : Node("Blend", NodeType::Processing),
       blendMode_(BlendMode::Normal),
       opacity_(100),
-      propertiesWidget_(nullptr) {
+      premultiplied_(false),
+      propertiesWidget_(nullptr),
+      blendModeComboBox_(nullptr),
+      opacitySlider_(nullptr),
+      opacityLabel_(nullptr),
+      premultipliedCheckBox_(nullptr),
+      foregroundKey_(0),
+      backgroundKey_(0),
+      maskKey_(0),
+      modeKey_(0) {
     // Add input connectors
     addInputConnector("Foreground");
     addInputConnector("Background");
+    addInputConnector("Mask"); // Optional, scales opacity per pixel
 
     // Add output connector
     addOutputConnector("Image");
@@ -37,8 +66,32 @@ void BlendNode::process() {
     Node* bgSourceNode = bgSourceConnector->getParentNode();
     cv::Mat background = bgSourceNode->getOutputImage(bgSourceConnector->getIndex());
 
+    // Conform the inputs only when their content changed, mode and opacity edits reuse them
+    conformInputs(foreground, fgSourceNode->getOutputHash(fgSourceConnector->getIndex()),
+                  background, bgSourceNode->getOutputHash(bgSourceConnector->getIndex()));
+
+    // Get the optional mask from the third input connector. Packed masks at the
+    // background's size are read bit by bit, anything else is conformed to 8 bits.
+    cv::Mat mask;
+    uint64_t maskHash = 0;
+    const BitMask* packedMask = nullptr;
+    if (inputConnectors_.size() > 2 && !inputConnectors_[2]->getConnections().empty()) {
+        NodeConnector* maskSourceConnector = inputConnectors_[2]->getConnections()[0]->getSource();
+        Node* maskSourceNode = maskSourceConnector->getParentNode();
+        int maskIndex = maskSourceConnector->getIndex();
+        if (maskSourceNode->isMaskOutput(maskIndex) &&
+            maskSourceNode->getOutputMask(maskIndex).size() == conformedBackground_.size()) {
+            packedMask = &maskSourceNode->getOutputMask(maskIndex);
+        } else {
+            mask = maskSourceNode->getOutputImage(maskIndex);
+            maskHash = maskSourceNode->getOutputHash(maskIndex);
+        }
+    }
+    conformMask(mask, maskHash, conformedBackground_);
+
     // Process the images
-    cv::Mat outputImage = applyBlend(foreground, background);
+    cv::Mat outputImage = blendImages(conformedForeground_, conformedForegroundAlpha_, conformedBackground_,
+                                      conformedMask_, packedMask);
 
     // Set output image
     setOutputImage(outputImage, 0);
@@ -78,9 +131,14 @@ QWidget* BlendNode::createPropertiesWidget() {
         opacityLayout->addWidget(opacitySlider_);
         opacityLayout->addWidget(opacityLabel_);
 
+        // Alpha handling
+        premultipliedCheckBox_ = new QCheckBox("Premultiplied alpha");
+        premultipliedCheckBox_->setChecked(premultiplied_);
+
         // Add all groups to main layout
         mainLayout->addWidget(modeGroup);
         mainLayout->addWidget(opacityGroup);
+        mainLayout->addWidget(premultipliedCheckBox_);
         mainLayout->addStretch();
 
         // Connect signals and slots
@@ -94,6 +152,11 @@ QWidget* BlendNode::createPropertiesWidget() {
             opacityLabel_->setText(QString::number(value) + "%");
             dirty_ = true;
         });
+
+        connect(premultipliedCheckBox_, &QCheckBox::toggled, [this](bool checked) {
+            premultiplied_ = checked;
+            dirty_ = true;
+        });
     }
 
     return propertiesWidget_;
@@ -126,8 +189,8 @@ bool BlendNode::isReady() const {
     NodeConnector* bgSourceConnector = bgConnection->getSource();
     Node* bgSourceNode = bgSourceConnector->getParentNode();
 
-    if (fgSourceNode->getOutputImage(fgSourceConnector->getIndex()).empty() ||
-        bgSourceNode->getOutputImage(bgSourceConnector->getIndex()).empty()) {
+    if (!fgSourceNode->hasOutput(fgSourceConnector->getIndex()) ||
+        !bgSourceNode->hasOutput(bgSourceConnector->getIndex())) {
         return false;
     }
 
@@ -158,446 +221,212 @@ void BlendNode::setOpacity(int opacity) {
     dirty_ = true;
 }
 
-cv::Mat BlendNode::applyBlend(const cv::Mat& foreground, const cv::Mat& background) {
-    if (foreground.empty() || background.empty()) {
-        return cv::Mat();
-    }
-
-    // Ensure both images have the same size and type
-    cv::Mat fg, bg;
-
-    // Resize foreground to match background size
-    if (foreground.size() != background.size()) {
-        cv::resize(foreground, fg, background.size());
-    } else {
-        fg = foreground.clone();
-    }
-
-    // Convert to same type if needed
-    if (fg.type() != background.type()) {
-        if (fg.channels() != background.channels()) {
-            if (fg.channels() == 1 && background.channels() == 3) {
-                cv::cvtColor(fg, fg, cv::COLOR_GRAY2BGR);
-            } else if (fg.channels() == 3 && background.channels() == 1) {
-                cv::cvtColor(background, bg, cv::COLOR_GRAY2BGR);
-            } else {
-                bg = background.clone();
-            }
-        } else {
-            bg = background.clone();
-        }
-    } else {
-        bg = background.clone();
-    }
-
-    // Apply blend based on selected mode
-    cv::Mat result;
-    switch (blendMode_) {
-        case BlendMode::Normal:
-            result = blendNormal(fg, bg);
-            break;
-        case BlendMode::Multiply:
-            result = blendMultiply(fg, bg);
-            break;
-        case BlendMode::Screen:
-            result = blendScreen(fg, bg);
-            break;
-        case BlendMode::Overlay:
-            result = blendOverlay(fg, bg);
-            break;
-        case BlendMode::Difference:
-            result = blendDifference(fg, bg);
-            break;
-        case BlendMode::Addition:
-            result = blendAddition(fg, bg);
-            break;
-        case BlendMode::Subtract:
-            result = blendSubtract(fg, bg);
-            break;
-        case BlendMode::Darken:
-            result = blendDarken(fg, bg);
-            break;
-        case BlendMode::Lighten:
-            result = blendLighten(fg, bg);
-            break;
-        default:
-            result = blendNormal(fg, bg);
-            break;
-    }
-
-    return result;
+bool BlendNode::isPremultiplied() const {
+    return premultiplied_;
 }
 
-cv::Mat BlendNode::blendNormal(const cv::Mat& fg, const cv::Mat& bg) {
-    cv::Mat result = bg.clone();
-
-    // Apply opacity
-    double alpha = opacity_ / 100.0;
-
-    if (fg.channels() == 1 && bg.channels() == 1) {
-        // Grayscale images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                uchar fgPixel = fg.at<uchar>(y, x);
-                uchar& bgPixel = result.at<uchar>(y, x);
-                bgPixel = cv::saturate_cast<uchar>(fgPixel * alpha + bgPixel * (1.0 - alpha));
-            }
-        }
-    } else if (fg.channels() == 3 && bg.channels() == 3) {
-        // Color images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                cv::Vec3b fgPixel = fg.at<cv::Vec3b>(y, x);
-                cv::Vec3b& bgPixel = result.at<cv::Vec3b>(y, x);
-
-                for (int c = 0; c < 3; c++) {
-                    bgPixel[c] = cv::saturate_cast<uchar>(fgPixel[c] * alpha + bgPixel[c] * (1.0 - alpha));
-                }
-            }
-        }
+void BlendNode::setPremultiplied(bool premultiplied) {
+    premultiplied_ = premultiplied;
+    if (premultipliedCheckBox_) {
+        premultipliedCheckBox_->setChecked(premultiplied_);
     }
-
-    return result;
+    dirty_ = true;
 }
 
-cv::Mat BlendNode::blendMultiply(const cv::Mat& fg, const cv::Mat& bg) {
-    cv::Mat result = bg.clone();
-
-    // Apply opacity
-    double alpha = opacity_ / 100.0;
-
-    if (fg.channels() == 1 && bg.channels() == 1) {
-        // Grayscale images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                uchar fgPixel = fg.at<uchar>(y, x);
-                uchar& bgPixel = result.at<uchar>(y, x);
-
-                // Multiply blend
-                uchar blendedPixel = cv::saturate_cast<uchar>((fgPixel * bgPixel) / 255.0);
-
-                // Apply opacity
-                bgPixel = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel * (1.0 - alpha));
-            }
-        }
-    } else if (fg.channels() == 3 && bg.channels() == 3) {
-        // Color images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                cv::Vec3b fgPixel = fg.at<cv::Vec3b>(y, x);
-                cv::Vec3b& bgPixel = result.at<cv::Vec3b>(y, x);
-
-                for (int c = 0; c < 3; c++) {
-                    // Multiply blend
-                    uchar blendedPixel = cv::saturate_cast<uchar>((fgPixel[c] * bgPixel[c]) / 255.0);
-
-                    // Apply opacity
-                    bgPixel[c] = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel[c] * (1.0 - alpha));
-                }
-            }
-        }
-    }
-
-    return result;
+std::vector<NodeParameter> BlendNode::getParameters() const {
+    return {
+        {"blendMode", static_cast<double>(blendMode_), ""},
+        {"opacity", static_cast<double>(opacity_), ""},
+        {"premultiplied", premultiplied_ ? 1.0 : 0.0, ""}
+    };
 }
 
-cv::Mat BlendNode::blendScreen(const cv::Mat& fg, const cv::Mat& bg) {
-    cv::Mat result = bg.clone();
-
-    // Apply opacity
-    double alpha = opacity_ / 100.0;
-
-    if (fg.channels() == 1 && bg.channels() == 1) {
-        // Grayscale images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                uchar fgPixel = fg.at<uchar>(y, x);
-                uchar& bgPixel = result.at<uchar>(y, x);
-
-                // Screen blend: 255 - ((255 - fg) * (255 - bg) / 255)
-                uchar blendedPixel = cv::saturate_cast<uchar>(255 - ((255 - fgPixel) * (255 - bgPixel) / 255.0));
-
-                // Apply opacity
-                bgPixel = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel * (1.0 - alpha));
-            }
-        }
-    } else if (fg.channels() == 3 && bg.channels() == 3) {
-        // Color images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                cv::Vec3b fgPixel = fg.at<cv::Vec3b>(y, x);
-                cv::Vec3b& bgPixel = result.at<cv::Vec3b>(y, x);
-
-                for (int c = 0; c < 3; c++) {
-                    // Screen blend
-                    uchar blendedPixel = cv::saturate_cast<uchar>(255 - ((255 - fgPixel[c]) * (255 - bgPixel[c]) / 255.0));
-
-                    // Apply opacity
-                    bgPixel[c] = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel[c] * (1.0 - alpha));
-                }
-            }
+void BlendNode::setParameters(const std::vector<NodeParameter>& parameters) {
+    for (const NodeParameter& parameter : parameters) {
+        if (parameter.name == "blendMode") {
+            setBlendMode(static_cast<BlendMode>(static_cast<int>(parameter.value)));
+        } else if (parameter.name == "opacity") {
+            setOpacity(static_cast<int>(parameter.value));
+        } else if (parameter.name == "premultiplied") {
+            setPremultiplied(parameter.value != 0.0);
         }
     }
-
-    return result;
 }
 
-cv::Mat BlendNode::blendOverlay(const cv::Mat& fg, const cv::Mat& bg) {
-    cv::Mat result = bg.clone();
-
-    // Apply opacity
-    double alpha = opacity_ / 100.0;
-
-    if (fg.channels() == 1 && bg.channels() == 1) {
-        // Grayscale images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                uchar fgPixel = fg.at<uchar>(y, x);
-                uchar& bgPixel = result.at<uchar>(y, x);
-
-                // Overlay blend
-                uchar blendedPixel;
-                if (bgPixel < 128) {
-                    // Multiply if background is dark
-                    blendedPixel = cv::saturate_cast<uchar>((2 * fgPixel * bgPixel) / 255.0);
-                } else {
-                    // Screen if background is light
-                    blendedPixel = cv::saturate_cast<uchar>(255 - 2 * ((255 - fgPixel) * (255 - bgPixel) / 255.0));
-                }
+void BlendNode::conformInputs(const cv::Mat& foreground, uint64_t foregroundHash,
+                              const cv::Mat& background, uint64_t backgroundHash) {
+    if (foreground.empty() || background.empty()) {
+        conformedForeground_ = cv::Mat();
+        conformedForegroundAlpha_ = cv::Mat();
+        conformedBackground_ = cv::Mat();
+        foregroundKey_ = 0;
+        backgroundKey_ = 0;
+        return;
+    }
 
-                // Apply opacity
-                bgPixel = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel * (1.0 - alpha));
-            }
+    // The foreground is matched to the background's size and channels
+    uint64_t foregroundKey = ImageUtils::combineHash(foregroundHash, static_cast<uint64_t>(background.rows));
+    foregroundKey = ImageUtils::combineHash(foregroundKey, static_cast<uint64_t>(background.cols));
+    foregroundKey = ImageUtils::combineHash(foregroundKey, static_cast<uint64_t>(background.type()));
+    foregroundKey = ImageUtils::combineHash(foregroundKey, premultiplied_ ? 1 : 0);
+    if (foregroundKey != foregroundKey_ || conformedForeground_.empty()) {
+        cv::Mat fg;
+        cv::Mat alpha;
+
+        // Resize foreground to match background size
+        if (foreground.size() != background.size()) {
+            cv::resize(foreground, fg, background.size());
+        } else {
+            fg = foreground;
         }
-    } else if (fg.channels() == 3 && bg.channels() == 3) {
-        // Color images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                cv::Vec3b fgPixel = fg.at<cv::Vec3b>(y, x);
-                cv::Vec3b& bgPixel = result.at<cv::Vec3b>(y, x);
-
-                for (int c = 0; c < 3; c++) {
-                    // Overlay blend
-                    uchar blendedPixel;
-                    if (bgPixel[c] < 128) {
-                        // Multiply if background is dark
-                        blendedPixel = cv::saturate_cast<uchar>((2 * fgPixel[c] * bgPixel[c]) / 255.0);
-                    } else {
-                        // Screen if background is light
-                        blendedPixel = cv::saturate_cast<uchar>(255 - 2 * ((255 - fgPixel[c]) * (255 - bgPixel[c]) / 255.0));
-                    }
 
-                    // Apply opacity
-                    bgPixel[c] = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel[c] * (1.0 - alpha));
-                }
+        // Grayscale foregrounds are expanded over color backgrounds, opaque over BGRA ones
+        if (fg.channels() == 1 && background.channels() == 3) {
+            cv::cvtColor(fg, fg, cv::COLOR_GRAY2BGR);
+        } else if (fg.channels() == 1 && background.channels() == 4) {
+            cv::cvtColor(fg, fg, cv::COLOR_GRAY2BGRA);
+        } else if (fg.channels() == 3 && background.channels() == 4) {
+            cv::cvtColor(fg, fg, cv::COLOR_BGR2BGRA);
+        } else if (fg.channels() == 4 && (background.channels() == 3 || background.channels() == 1)) {
+            // BGRA layers over opaque backgrounds are split into color and an alpha used as coverage
+            if (premultiplied_) {
+                fg = unpremultiply(fg);
             }
+            cv::extractChannel(fg, alpha, 3);
+            cv::cvtColor(fg, fg, background.channels() == 1 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGRA2BGR);
+        } else if (premultiplied_) {
+            fg = unpremultiply(fg);
         }
-    }
-
-    return result;
-}
 
-cv::Mat BlendNode::blendDifference(const cv::Mat& fg, const cv::Mat& bg) {
-    cv::Mat result = bg.clone();
-
-    // Apply opacity
-    double alpha = opacity_ / 100.0;
-
-    if (fg.channels() == 1 && bg.channels() == 1) {
-        // Grayscale images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                uchar fgPixel = fg.at<uchar>(y, x);
-                uchar& bgPixel = result.at<uchar>(y, x);
-
-                // Difference blend: |fg - bg|
-                uchar blendedPixel = cv::saturate_cast<uchar>(std::abs(fgPixel - bgPixel));
+        conformedForeground_ = fg;
+        conformedForegroundAlpha_ = alpha;
+        foregroundKey_ = foregroundKey;
+    }
 
-                // Apply opacity
-                bgPixel = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel * (1.0 - alpha));
-            }
-        }
-    } else if (fg.channels() == 3 && bg.channels() == 3) {
-        // Color images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                cv::Vec3b fgPixel = fg.at<cv::Vec3b>(y, x);
-                cv::Vec3b& bgPixel = result.at<cv::Vec3b>(y, x);
-
-                for (int c = 0; c < 3; c++) {
-                    // Difference blend
-                    uchar blendedPixel = cv::saturate_cast<uchar>(std::abs(fgPixel[c] - bgPixel[c]));
-
-                    // Apply opacity
-                    bgPixel[c] = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel[c] * (1.0 - alpha));
-                }
-            }
+    // A grayscale background is expanded under a color foreground
+    uint64_t backgroundKey = ImageUtils::combineHash(backgroundHash, static_cast<uint64_t>(foreground.type()));
+    backgroundKey = ImageUtils::combineHash(backgroundKey, premultiplied_ ? 1 : 0);
+    if (backgroundKey != backgroundKey_ || conformedBackground_.empty()) {
+        if (foreground.channels() == 3 && background.channels() == 1) {
+            cv::cvtColor(background, conformedBackground_, cv::COLOR_GRAY2BGR);
+        } else if (premultiplied_) {
+            conformedBackground_ = unpremultiply(background);
+        } else {
+            conformedBackground_ = background;
         }
+        backgroundKey_ = backgroundKey;
     }
-
-    return result;
 }
 
-cv::Mat BlendNode::blendAddition(const cv::Mat& fg, const cv::Mat& bg) {
-    cv::Mat result = bg.clone();
-
-    // Apply opacity
-    double alpha = opacity_ / 100.0;
-
-    if (fg.channels() == 1 && bg.channels() == 1) {
-        // Grayscale images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                uchar fgPixel = fg.at<uchar>(y, x);
-                uchar& bgPixel = result.at<uchar>(y, x);
+void BlendNode::conformMask(const cv::Mat& mask, uint64_t maskHash, const cv::Mat& background) {
+    if (mask.empty() || background.empty()) {
+        conformedMask_ = cv::Mat();
+        maskKey_ = 0;
+        return;
+    }
 
-                // Addition blend: fg + bg
-                uchar blendedPixel = cv::saturate_cast<uchar>(fgPixel + bgPixel);
+    // The mask becomes one 8-bit channel at the background's size
+    uint64_t maskKey = ImageUtils::combineHash(maskHash, static_cast<uint64_t>(background.rows));
+    maskKey = ImageUtils::combineHash(maskKey, static_cast<uint64_t>(background.cols));
+    if (maskKey == maskKey_ && !conformedMask_.empty()) {
+        return;
+    }
 
-                // Apply opacity
-                bgPixel = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel * (1.0 - alpha));
-            }
+    cv::Mat m = mask;
+    try {
+        // BGRA masks use their alpha, color masks their luminance
+        if (m.channels() == 4) {
+            cv::extractChannel(m, m, 3);
+        } else if (m.channels() == 3) {
+            cv::cvtColor(m, m, cv::COLOR_BGR2GRAY);
         }
-    } else if (fg.channels() == 3 && bg.channels() == 3) {
-        // Color images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                cv::Vec3b fgPixel = fg.at<cv::Vec3b>(y, x);
-                cv::Vec3b& bgPixel = result.at<cv::Vec3b>(y, x);
-
-                for (int c = 0; c < 3; c++) {
-                    // Addition blend
-                    uchar blendedPixel = cv::saturate_cast<uchar>(fgPixel[c] + bgPixel[c]);
-
-                    // Apply opacity
-                    bgPixel[c] = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel[c] * (1.0 - alpha));
-                }
-            }
+        if (m.depth() != CV_8U) {
+            m.convertTo(m, CV_8U);
         }
+        if (m.size() != background.size()) {
+            cv::resize(m, m, background.size());
+        }
+    } catch (const cv::Exception&) {
+        m = cv::Mat();
     }
 
-    return result;
+    conformedMask_ = m.type() == CV_8UC1 ? m : cv::Mat();
+    maskKey_ = maskKey;
 }
 
-cv::Mat BlendNode::blendSubtract(const cv::Mat& fg, const cv::Mat& bg) {
-    cv::Mat result = bg.clone();
-
-    // Apply opacity
-    double alpha = opacity_ / 100.0;
-
-    if (fg.channels() == 1 && bg.channels() == 1) {
-        // Grayscale images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                uchar fgPixel = fg.at<uchar>(y, x);
-                uchar& bgPixel = result.at<uchar>(y, x);
-
-                // Subtract blend: bg - fg
-                uchar blendedPixel = cv::saturate_cast<uchar>(bgPixel - fgPixel);
+cv::Mat BlendNode::blendImages(const cv::Mat& fg, const cv::Mat& fgAlpha, const cv::Mat& bg, const cv::Mat& mask,
+                               const BitMask* packedMask) {
+    // Only matching 8-bit images can be blended, anything else passes the background through
+    if (fg.type() != bg.type() || fg.depth() != CV_8U) {
+        return bg.clone();
+    }
 
-                // Apply opacity
-                bgPixel = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel * (1.0 - alpha));
-            }
-        }
-    } else if (fg.channels() == 3 && bg.channels() == 3) {
-        // Color images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                cv::Vec3b fgPixel = fg.at<cv::Vec3b>(y, x);
-                cv::Vec3b& bgPixel = result.at<cv::Vec3b>(y, x);
-
-                for (int c = 0; c < 3; c++) {
-                    // Subtract blend
-                    uchar blendedPixel = cv::saturate_cast<uchar>(bgPixel[c] - fgPixel[c]);
-
-                    // Apply opacity
-                    bgPixel[c] = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel[c] * (1.0 - alpha));
-                }
+    size_t rowBytes = bg.cols * bg.elemSize();
+    int grain = ParallelUtils::stripeRows(rowBytes);
+    bool keepAlpha = bg.channels() == 4;
+
+    // The full-opacity mode result only depends on the inputs and the mode
+    uint64_t modeKey = ImageUtils::combineHash(ImageUtils::combineHash(foregroundKey_, backgroundKey_),
+                                               static_cast<uint64_t>(blendMode_));
+    if (modeResult_.empty() || modeKey != modeKey_ || modeResult_.size() != bg.size() || modeResult_.type() != bg.type()) {
+        // Blend row stripes in parallel with the vectorized kernels, BGRA keeps the background alpha
+        cv::Mat result(bg.size(), bg.type());
+        BlendMode mode = blendMode_;
+        ParallelUtils::parallelFor(bg.rows, grain, [&](int begin, int end) {
+            for (int y = begin; y < end; y++) {
+                BlendKernels::blendRow(mode, fg.ptr(y), bg.ptr(y), result.ptr(y), rowBytes, 100, keepAlpha);
             }
-        }
+        });
+        modeResult_ = result;
+        modeKey_ = modeKey;
     }
 
-    return result;
-}
-
-cv::Mat BlendNode::blendDarken(const cv::Mat& fg, const cv::Mat& bg) {
-    cv::Mat result = bg.clone();
-
-    // Apply opacity
-    double alpha = opacity_ / 100.0;
-
-    if (fg.channels() == 1 && bg.channels() == 1) {
-        // Grayscale images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                uchar fgPixel = fg.at<uchar>(y, x);
-                uchar& bgPixel = result.at<uchar>(y, x);
-
-                // Darken blend: min(fg, bg)
-                uchar blendedPixel = std::min(fgPixel, bgPixel);
+    cv::Mat result(bg.size(), bg.type());
+    int opacity = opacity_;
+
+    // Masks and alpha are applied with opacity in one fused pass over the mode result
+    if (!mask.empty() || packedMask || !fgAlpha.empty() || bg.channels() == 4) {
+        int channels = bg.channels();
+        bool premultiplied = premultiplied_;
+        ParallelUtils::parallelFor(bg.rows, grain, [&](int begin, int end) {
+            // Packed masks are expanded a row at a time into coverage bytes
+            std::vector<uint8_t> coverageRow(packedMask || !fgAlpha.empty() ? bg.cols : 0);
+            for (int y = begin; y < end; y++) {
+                const uint8_t* coverage = mask.empty() ? nullptr : mask.ptr(y);
+                if (packedMask) {
+                    packedMask->expandRow(y, coverageRow.data());
+                    coverage = coverageRow.data();
+                }
 
-                // Apply opacity
-                bgPixel = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel * (1.0 - alpha));
-            }
-        }
-    } else if (fg.channels() == 3 && bg.channels() == 3) {
-        // Color images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                cv::Vec3b fgPixel = fg.at<cv::Vec3b>(y, x);
-                cv::Vec3b& bgPixel = result.at<cv::Vec3b>(y, x);
-
-                for (int c = 0; c < 3; c++) {
-                    // Darken blend
-                    uchar blendedPixel = std::min(fgPixel[c], bgPixel[c]);
-
-                    // Apply opacity
-                    bgPixel[c] = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel[c] * (1.0 - alpha));
+                // The alpha of a BGRA layer over an opaque background scales the mask
+                if (!fgAlpha.empty()) {
+                    const uint8_t* alpha = fgAlpha.ptr(y);
+                    if (coverage) {
+                        for (int x = 0; x < bg.cols; x++) {
+                            coverageRow[x] = static_cast<uint8_t>((alpha[x] * coverage[x] + 127) / 255);
+                        }
+                        coverage = coverageRow.data();
+                    } else {
+                        coverage = alpha;
+                    }
                 }
+                BlendKernels::compositeRow(modeResult_.ptr(y), fg.ptr(y), bg.ptr(y), coverage,
+                                           result.ptr(y), bg.cols, channels, opacity, premultiplied);
             }
-        }
+        });
+        return result;
     }
 
-    return result;
-}
-
-cv::Mat BlendNode::blendLighten(const cv::Mat& fg, const cv::Mat& bg) {
-    cv::Mat result = bg.clone();
-
-    // Apply opacity
-    double alpha = opacity_ / 100.0;
-
-    if (fg.channels() == 1 && bg.channels() == 1) {
-        // Grayscale images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                uchar fgPixel = fg.at<uchar>(y, x);
-                uchar& bgPixel = result.at<uchar>(y, x);
-
-                // Lighten blend: max(fg, bg)
-                uchar blendedPixel = std::max(fgPixel, bgPixel);
+    if (opacity_ == 100) {
+        return modeResult_;
+    }
 
-                // Apply opacity
-                bgPixel = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel * (1.0 - alpha));
-            }
+    // Opacity is a single lerp of the mode result against the background
+    ParallelUtils::parallelFor(bg.rows, grain, [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            BlendKernels::lerpRow(modeResult_.ptr(y), bg.ptr(y), result.ptr(y), rowBytes, opacity, keepAlpha);
         }
-    } else if (fg.channels() == 3 && bg.channels() == 3) {
-        // Color images
-        for (int y = 0; y < result.rows; y++) {
-            for (int x = 0; x < result.cols; x++) {
-                cv::Vec3b fgPixel = fg.at<cv::Vec3b>(y, x);
-                cv::Vec3b& bgPixel = result.at<cv::Vec3b>(y, x);
-
-                for (int c = 0; c < 3; c++) {
-                    // Lighten blend
-                    uchar blendedPixel = std::max(fgPixel[c], bgPixel[c]);
-
-                    // Apply opacity
-                    bgPixel[c] = cv::saturate_cast<uchar>(blendedPixel * alpha + bgPixel[c] * (1.0 - alpha));
-                }
-            }
-        }
-    }
+    });
 
     return result;
 }
@@ -1,24 +1,14 @@
 #pragma once
 
 #include "Node.h"
+#include "../utils/BlendKernels.h"
 #include <QSlider>
 #include <QLabel>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QComboBox>
 #include <QGroupBox>
-
-enum class BlendMode {
-    Normal,
-    Multiply,
-    Screen,
-    Overlay,
-    Difference,
-    Addition,
-    Subtract,
-    Darken,
-    Lighten
-};
+#include <QCheckBox>
 
 class BlendNode : public Node {
 public:
@@ -29,6 +19,8 @@ public:
     void process() override;
     QWidget* createPropertiesWidget() override;
     bool isReady() const override;
+    std::vector<NodeParameter> getParameters() const override;
+    void setParameters(const std::vector<NodeParameter>& parameters) override;
 
     // Getters and setters
     BlendMode getBlendMode() const;
@@ -37,26 +29,40 @@ public:
     int getOpacity() const;
     void setOpacity(int opacity);
 
+    // 4-channel inputs hold premultiplied color, the output is premultiplied as well
+    bool isPremultiplied() const;
+    void setPremultiplied(bool premultiplied);
+
 private:
     // Processing parameters
     BlendMode blendMode_;
     int opacity_; // 0-100
+    bool premultiplied_;
 
     // UI components
     QWidget* propertiesWidget_;
     QComboBox* blendModeComboBox_;
     QSlider* opacitySlider_;
     QLabel* opacityLabel_;
+    QCheckBox* premultipliedCheckBox_;
+
+    // Inputs conformed to a common size and channel count, reused until an input changes
+    cv::Mat conformedForeground_;
+    cv::Mat conformedForegroundAlpha_; // BGRA layers over opaque backgrounds, empty otherwise
+    cv::Mat conformedBackground_;
+    cv::Mat conformedMask_;
+    uint64_t foregroundKey_;
+    uint64_t backgroundKey_;
+    uint64_t maskKey_;
+
+    // Blend of the conformed inputs at full opacity, opacity edits only lerp it against the background
+    cv::Mat modeResult_;
+    uint64_t modeKey_;
 
     // Helper methods
-    cv::Mat applyBlend(const cv::Mat& foreground, const cv::Mat& background);
-    cv::Mat blendNormal(const cv::Mat& fg, const cv::Mat& bg);
-    cv::Mat blendMultiply(const cv::Mat& fg, const cv::Mat& bg);
-    cv::Mat blendScreen(const cv::Mat& fg, const cv::Mat& bg);
-    cv::Mat blendOverlay(const cv::Mat& fg, const cv::Mat& bg);
-    cv::Mat blendDifference(const cv::Mat& fg, const cv::Mat& bg);
-    cv::Mat blendAddition(const cv::Mat& fg, const cv::Mat& bg);
-    cv::Mat blendSubtract(const cv::Mat& fg, const cv::Mat& bg);
-    cv::Mat blendDarken(const cv::Mat& fg, const cv::Mat& bg);
-    cv::Mat blendLighten(const cv::Mat& fg, const cv::Mat& bg);
+    void conformInputs(const cv::Mat& foreground, uint64_t foregroundHash,
+                       const cv::Mat& background, uint64_t backgroundHash);
+    void conformMask(const cv::Mat& mask, uint64_t maskHash, const cv::Mat& background);
+    cv::Mat blendImages(const cv::Mat& fg, const cv::Mat& fgAlpha, const cv::Mat& bg, const cv::Mat& mask,
+                        const BitMask* packedMask = nullptr);
 };
@@ -2,8 +2,29 @@
 #include <QCheckBox>
 #include <QGridLayout>
 #include <QGroupBox>
+#include <iomanip>
 #include <sstream>
 
+namespace {
+
+const int kMaxRadius = 300;
+
+// Largest radius for filters whose cost grows with the window, the exact
+// bilateral and OpenCV's median of non-8-bit images
+const int kMaxExactRadius = 20;
+
+// From this radius up the recursive Gaussian is faster than the separable kernel
+const int kRecursiveGaussianRadius = 16;
+
+// Below this radius OpenCV's sorting-network median is faster than histograms
+const int kHistogramMedianRadius = 3;
+
+// Bilateral grid cell size limits, in percent of the matching sigma
+const int kMinGridSampling = 25;
+const int kMaxGridSampling = 200;
+
+} // namespace
+
 BlurNode::BlurNode()
     : Node("Blur", NodeType::Processing),
       radius_(3),
@@ -11,7 +32,25 @@ BlurNode::BlurNode()
       directional_(false),
       xDirection_(0),
       yDirection_(0),
-      propertiesWidget_(nullptr) {
+      fastBilateral_(false),
+      gridSpatialSampling_(100),
+      gridRangeSampling_(100),
+      propertiesWidget_(nullptr),
+      radiusSlider_(nullptr),
+      radiusValueLabel_(nullptr),
+      blurTypeComboBox_(nullptr),
+      directionalCheckBox_(nullptr),
+      xDirectionSlider_(nullptr),
+      yDirectionSlider_(nullptr),
+      xDirectionLabel_(nullptr),
+      yDirectionLabel_(nullptr),
+      kernelPreviewLabel_(nullptr),
+      fastBilateralCheckBox_(nullptr),
+      gridSpatialSlider_(nullptr),
+      gridRangeSlider_(nullptr),
+      gridSpatialLabel_(nullptr),
+      gridRangeLabel_(nullptr),
+      integralKey_(0) {
     // Add input and output connectors
     addInputConnector("Image");
     addOutputConnector("Image");
@@ -37,7 +76,7 @@ void BlurNode::process() {
     cv::Mat inputImage = sourceNode->getOutputImage(sourceConnector->getIndex());
 
     // Process the image
-    cv::Mat outputImage = applyBlur(inputImage);
+    cv::Mat outputImage = applyBlur(inputImage, sourceNode->getOutputHash(sourceConnector->getIndex()));
 
     // Set output image
     setOutputImage(outputImage, 0);
@@ -66,7 +105,7 @@ QWidget* BlurNode::createPropertiesWidget() {
         QGroupBox* radiusGroup = new QGroupBox("Blur Radius");
         QHBoxLayout* radiusLayout = new QHBoxLayout(radiusGroup);
         radiusSlider_ = new QSlider(Qt::Horizontal);
-        radiusSlider_->setRange(1, 20);
+        radiusSlider_->setRange(1, kMaxRadius);
         radiusSlider_->setValue(radius_);
         radiusValueLabel_ = new QLabel(QString::number(radius_));
         radiusLayout->addWidget(radiusSlider_);
@@ -98,6 +137,32 @@ QWidget* BlurNode::createPropertiesWidget() {
         directionalLayout->addWidget(directionalCheckBox_);
         directionalLayout->addLayout(directionControlsLayout);
 
+        // Bilateral filter controls
+        QGroupBox* bilateralGroup = new QGroupBox("Bilateral Filter");
+        QVBoxLayout* bilateralLayout = new QVBoxLayout(bilateralGroup);
+        fastBilateralCheckBox_ = new QCheckBox("Fast (Bilateral Grid)");
+        fastBilateralCheckBox_->setChecked(fastBilateral_);
+
+        QGridLayout* gridControlsLayout = new QGridLayout();
+        gridControlsLayout->addWidget(new QLabel("Spatial Sampling:"), 0, 0);
+        gridSpatialSlider_ = new QSlider(Qt::Horizontal);
+        gridSpatialSlider_->setRange(kMinGridSampling, kMaxGridSampling);
+        gridSpatialSlider_->setValue(gridSpatialSampling_);
+        gridSpatialLabel_ = new QLabel(QString::number(gridSpatialSampling_) + "%");
+        gridControlsLayout->addWidget(gridSpatialSlider_, 0, 1);
+        gridControlsLayout->addWidget(gridSpatialLabel_, 0, 2);
+
+        gridControlsLayout->addWidget(new QLabel("Range Sampling:"), 1, 0);
+        gridRangeSlider_ = new QSlider(Qt::Horizontal);
+        gridRangeSlider_->setRange(kMinGridSampling, kMaxGridSampling);
+        gridRangeSlider_->setValue(gridRangeSampling_);
+        gridRangeLabel_ = new QLabel(QString::number(gridRangeSampling_) + "%");
+        gridControlsLayout->addWidget(gridRangeSlider_, 1, 1);
+        gridControlsLayout->addWidget(gridRangeLabel_, 1, 2);
+
+        bilateralLayout->addWidget(fastBilateralCheckBox_);
+        bilateralLayout->addLayout(gridControlsLayout);
+
         // Kernel preview
         QGroupBox* kernelGroup = new QGroupBox("Kernel Preview");
         QVBoxLayout* kernelLayout = new QVBoxLayout(kernelGroup);
@@ -109,6 +174,7 @@ QWidget* BlurNode::createPropertiesWidget() {
         mainLayout->addWidget(typeGroup);
         mainLayout->addWidget(radiusGroup);
         mainLayout->addWidget(directionalGroup);
+        mainLayout->addWidget(bilateralGroup);
         mainLayout->addWidget(kernelGroup);
         mainLayout->addStretch();
 
@@ -151,9 +217,31 @@ QWidget* BlurNode::createPropertiesWidget() {
             dirty_ = true;
         });
 
+        connect(fastBilateralCheckBox_, &QCheckBox::toggled, [this](bool checked) {
+            fastBilateral_ = checked;
+            gridSpatialSlider_->setEnabled(checked);
+            gridRangeSlider_->setEnabled(checked);
+            updateKernelPreview();
+            dirty_ = true;
+        });
+
+        connect(gridSpatialSlider_, &QSlider::valueChanged, [this](int value) {
+            gridSpatialSampling_ = value;
+            gridSpatialLabel_->setText(QString::number(value) + "%");
+            dirty_ = true;
+        });
+
+        connect(gridRangeSlider_, &QSlider::valueChanged, [this](int value) {
+            gridRangeSampling_ = value;
+            gridRangeLabel_->setText(QString::number(value) + "%");
+            dirty_ = true;
+        });
+
         // Initialize UI state
         xDirectionSlider_->setEnabled(directional_);
         yDirectionSlider_->setEnabled(directional_);
+        gridSpatialSlider_->setEnabled(fastBilateral_);
+        gridRangeSlider_->setEnabled(fastBilateral_);
     }
 
     return propertiesWidget_;
@@ -164,7 +252,7 @@ int BlurNode::getRadius() const {
 }
 
 void BlurNode::setRadius(int radius) {
-    radius_ = std::max(1, std::min(20, radius));
+    radius_ = std::max(1, std::min(kMaxRadius, radius));
     if (radiusSlider_) {
         radiusSlider_->setValue(radius_);
     }
@@ -219,44 +307,99 @@ void BlurNode::setYDirection(int y) {
     dirty_ = true;
 }
 
-cv::Mat BlurNode::applyBlur(const cv::Mat& input) {
+bool BlurNode::isFastBilateral() const {
+    return fastBilateral_;
+}
+
+void BlurNode::setFastBilateral(bool fast) {
+    fastBilateral_ = fast;
+    if (fastBilateralCheckBox_) {
+        fastBilateralCheckBox_->setChecked(fastBilateral_);
+    }
+    dirty_ = true;
+}
+
+int BlurNode::getGridSpatialSampling() const {
+    return gridSpatialSampling_;
+}
+
+void BlurNode::setGridSpatialSampling(int percent) {
+    gridSpatialSampling_ = std::max(kMinGridSampling, std::min(kMaxGridSampling, percent));
+    if (gridSpatialSlider_) {
+        gridSpatialSlider_->setValue(gridSpatialSampling_);
+    }
+    dirty_ = true;
+}
+
+int BlurNode::getGridRangeSampling() const {
+    return gridRangeSampling_;
+}
+
+void BlurNode::setGridRangeSampling(int percent) {
+    gridRangeSampling_ = std::max(kMinGridSampling, std::min(kMaxGridSampling, percent));
+    if (gridRangeSlider_) {
+        gridRangeSlider_->setValue(gridRangeSampling_);
+    }
+    dirty_ = true;
+}
+
+std::vector<NodeParameter> BlurNode::getParameters() const {
+    return {
+        {"radius", static_cast<double>(radius_), ""},
+        {"blurType", static_cast<double>(blurType_), ""},
+        {"directional", directional_ ? 1.0 : 0.0, ""},
+        {"xDirection", static_cast<double>(xDirection_), ""},
+        {"yDirection", static_cast<double>(yDirection_), ""},
+        {"fastBilateral", fastBilateral_ ? 1.0 : 0.0, ""},
+        {"gridSpatialSampling", static_cast<double>(gridSpatialSampling_), ""},
+        {"gridRangeSampling", static_cast<double>(gridRangeSampling_), ""}
+    };
+}
+
+void BlurNode::setParameters(const std::vector<NodeParameter>& parameters) {
+    for (const NodeParameter& parameter : parameters) {
+        if (parameter.name == "radius") {
+            setRadius(static_cast<int>(parameter.value));
+        } else if (parameter.name == "blurType") {
+            setBlurType(static_cast<BlurType>(static_cast<int>(parameter.value)));
+        } else if (parameter.name == "directional") {
+            setDirectional(parameter.value != 0.0);
+        } else if (parameter.name == "xDirection") {
+            setXDirection(static_cast<int>(parameter.value));
+        } else if (parameter.name == "yDirection") {
+            setYDirection(static_cast<int>(parameter.value));
+        } else if (parameter.name == "fastBilateral") {
+            setFastBilateral(parameter.value != 0.0);
+        } else if (parameter.name == "gridSpatialSampling") {
+            setGridSpatialSampling(static_cast<int>(parameter.value));
+        } else if (parameter.name == "gridRangeSampling") {
+            setGridRangeSampling(static_cast<int>(parameter.value));
+        }
+    }
+}
+
+cv::Mat BlurNode::applyBlur(const cv::Mat& input, uint64_t inputHash) {
     if (input.empty()) {
         return cv::Mat();
     }
 
+    // The summed-area table is large, only keep it while the box path uses it
+    if (blurType_ != BlurType::Box || input.depth() != CV_8U) {
+        integralImage_.release();
+        integralKey_ = 0;
+    }
+
     cv::Mat output;
 
     // Apply blur based on selected type
     switch (blurType_) {
         case BlurType::Gaussian: {
             if (directional_) {
-                // Create directional kernel
-                int ksize = 2 * radius_ + 1;
-                cv::Mat kernel = cv::getGaussianKernel(ksize, -1);
-                cv::Mat kernel2 = cv::getGaussianKernel(ksize, -1);
-                cv::Mat kernelXY = kernel * kernel2.t();
-
-                // Modify kernel for directionality
-                for (int i = 0; i < ksize; i++) {
-                    for (int j = 0; j < ksize; j++) {
-                        float x = (j - radius_) / static_cast<float>(radius_);
-                        float y = (i - radius_) / static_cast<float>(radius_);
-
-                        float dirX = xDirection_ / 10.0f;
-                        float dirY = yDirection_ / 10.0f;
-
-                        float dot = x * dirX + y * dirY;
-                        float factor = std::max(0.0f, dot);
-
-                        kernelXY.at<float>(i, j) *= factor;
-                    }
-                }
-
-                // Normalize kernel
-                cv::normalize(kernelXY, kernelXY, 1.0, 0.0, cv::NORM_L1);
-
-                // Apply filter
-                cv::filter2D(input, output, -1, kernelXY);
+                // Two line filters in the rotated frame instead of a dense 2D kernel
+                BlurFilters::directionalBlur(input, output, getDirectionalKernel());
+            } else if (radius_ >= kRecursiveGaussianRadius) {
+                // Recursive Gaussian, same sigma as the kernel but constant cost per pixel
+                BlurFilters::recursiveGaussian(input, output, BlurFilters::gaussianSigma(radius_));
             } else {
                 // Standard Gaussian blur
                 cv::GaussianBlur(input, output, cv::Size(2 * radius_ + 1, 2 * radius_ + 1), 0);
@@ -264,15 +407,43 @@ cv::Mat BlurNode::applyBlur(const cv::Mat& input) {
             break;
         }
         case BlurType::Box: {
-            cv::boxFilter(input, output, -1, cv::Size(2 * radius_ + 1, 2 * radius_ + 1));
+            if (input.depth() == CV_8U) {
+                // The integral image only depends on the input, so radius changes reuse it
+                if (integralImage_.empty() || inputHash != integralKey_ || inputHash == 0) {
+                    integralImage_ = BlurFilters::integralImage(input);
+                    integralKey_ = inputHash;
+                }
+                BlurFilters::boxBlur(integralImage_, output, radius_);
+            } else {
+                cv::boxFilter(input, output, -1, cv::Size(2 * radius_ + 1, 2 * radius_ + 1));
+            }
             break;
         }
         case BlurType::Median: {
-            cv::medianBlur(input, output, 2 * radius_ + 1);
+            if (input.depth() == CV_8U && radius_ >= kHistogramMedianRadius) {
+                // Sliding histogram median, constant cost per pixel and parallel by stripes
+                BlurFilters::medianBlur(input, output, radius_);
+            } else {
+                cv::medianBlur(input, output, 2 * std::min(radius_, kMaxExactRadius) + 1);
+            }
             break;
         }
         case BlurType::Bilateral: {
-            cv::bilateralFilter(input, output, 2 * radius_ + 1, radius_ * 2.0, radius_ * 2.0);
+            bool filtered = false;
+            if (fastBilateral_ && input.depth() == CV_8U) {
+                // The exact filter's window is nearly flat out to the radius, a
+                // Gaussian with sigma radius / 2 has the same spread
+                double sigmaSpace = std::max(1.0, radius_ * 0.5);
+                double sigmaRange = radius_ * 2.0;
+                filtered = BlurFilters::bilateralGrid(input, output, sigmaSpace, sigmaRange,
+                                                      sigmaSpace * gridSpatialSampling_ / 100.0,
+                                                      sigmaRange * gridRangeSampling_ / 100.0);
+            }
+            // Grids too large for memory use the exact filter
+            if (!filtered) {
+                int radius = std::min(radius_, kMaxExactRadius);
+                cv::bilateralFilter(input, output, 2 * radius + 1, radius * 2.0, radius * 2.0);
+            }
             break;
         }
     }
@@ -280,6 +451,14 @@ cv::Mat BlurNode::applyBlur(const cv::Mat& input) {
     return output;
 }
 
+const BlurFilters::DirectionalKernel& BlurNode::getDirectionalKernel() const {
+    if (directionalKernel_.alongProfile.empty() || directionalKernel_.radius != radius_ ||
+        directionalKernel_.xDirection != xDirection_ || directionalKernel_.yDirection != yDirection_) {
+        directionalKernel_ = BlurFilters::makeDirectionalKernel(radius_, xDirection_, yDirection_);
+    }
+    return directionalKernel_;
+}
+
 void BlurNode::updateKernelPreview() {
     if (kernelPreviewLabel_) {
         kernelPreviewLabel_->setText(getKernelString());
@@ -298,43 +477,26 @@ QString BlurNode::getKernelString() const {
                 ss << "Directional Gaussian Kernel (" << ksize << "x" << ksize << ")\n";
                 ss << "X Direction: " << xDirection_ << ", Y Direction: " << yDirection_ << "\n\n";
 
-                // Create directional kernel
-                cv::Mat kernel = cv::getGaussianKernel(ksize, -1);
-                cv::Mat kernel2 = cv::getGaussianKernel(ksize, -1);
-                cv::Mat kernelXY = kernel * kernel2.t();
-
-                // Modify kernel for directionality
-                for (int i = 0; i < ksize; i++) {
-                    for (int j = 0; j < ksize; j++) {
-                        float x = (j - radius_) / static_cast<float>(radius_);
-                        float y = (i - radius_) / static_cast<float>(radius_);
-
-                        float dirX = xDirection_ / 10.0f;
-                        float dirY = yDirection_ / 10.0f;
-
-                        float dot = x * dirX + y * dirY;
-                        float factor = std::max(0.0f, dot);
-
-                        kernelXY.at<float>(i, j) *= factor;
-                    }
-                }
-
-                // Normalize kernel
-                cv::normalize(kernelXY, kernelXY, 1.0, 0.0, cv::NORM_L1);
-
-                // Display kernel values
-                for (int i = 0; i < std::min(5, ksize); i++) {
-                    for (int j = 0; j < std::min(5, ksize); j++) {
-                        ss << std::fixed << std::setprecision(3) << kernelXY.at<float>(i, j) << " ";
-                    }
-                    ss << "\n";
+                // Show the line profiles the blur is built from
+                const BlurFilters::DirectionalKernel& kernel = getDirectionalKernel();
+                ss << "Along direction:\n";
+                for (size_t i = 0; i < std::min<size_t>(5, kernel.alongProfile.size()); i++) {
+                    ss << std::fixed << std::setprecision(3) << kernel.alongProfile[i] << " ";
                 }
+                ss << (kernel.alongProfile.size() > 5 ? "...\n" : "\n");
 
-                if (ksize > 5) {
-                    ss << "...\n";
+                ss << "Across direction:\n";
+                size_t acrossStart = kernel.acrossProfile.size() / 2 - std::min(2, radius_);
+                for (size_t i = acrossStart; i < std::min(acrossStart + 5, kernel.acrossProfile.size()); i++) {
+                    ss << std::fixed << std::setprecision(3) << kernel.acrossProfile[i] << " ";
                 }
+                ss << (kernel.acrossProfile.size() > 5 ? "...\n" : "\n");
             } else {
-                ss << "Gaussian Kernel (" << ksize << "x" << ksize << ")\n\n";
+                ss << "Gaussian Kernel (" << ksize << "x" << ksize << ")\n";
+                if (radius_ >= kRecursiveGaussianRadius) {
+                    ss << "Recursive, sigma " << std::fixed << std::setprecision(1) << BlurFilters::gaussianSigma(radius_) << "\n";
+                }
+                ss << "\n";
 
                 // Create Gaussian kernel
                 cv::Mat kernel = cv::getGaussianKernel(ksize, -1);
@@ -377,7 +539,11 @@ QString BlurNode::getKernelString() const {
             break;
         }
         case BlurType::Bilateral: {
-            ss << "Bilateral Filter (" << ksize << "x" << ksize << ")\n\n";
+            ss << "Bilateral Filter (" << ksize << "x" << ksize << ")\n";
+            if (fastBilateral_) {
+                ss << "Approximated on a bilateral grid\n";
+            }
+            ss << "\n";
             ss << "Edge-preserving filter that\ncombines domain and range\nfiltering. Preserves edges\nwhile smoothing flat areas.";
             break;
         }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Node.h"
+#include "../utils/BlurFilters.h"
 #include <QSlider>
 #include <QLabel>
 #include <QPushButton>
@@ -24,6 +25,8 @@ public:
     // Node interface implementation
     void process() override;
     QWidget* createPropertiesWidget() override;
+    std::vector<NodeParameter> getParameters() const override;
+    void setParameters(const std::vector<NodeParameter>& parameters) override;
 
     // Getters and setters
     int getRadius() const;
@@ -41,6 +44,15 @@ public:
     int getYDirection() const;
     void setYDirection(int y);
 
+    bool isFastBilateral() const;
+    void setFastBilateral(bool fast);
+
+    int getGridSpatialSampling() const;
+    void setGridSpatialSampling(int percent);
+
+    int getGridRangeSampling() const;
+    void setGridRangeSampling(int percent);
+
 private:
     // Processing parameters
     int radius_;
@@ -48,6 +60,9 @@ private:
     bool directional_;
     int xDirection_;
     int yDirection_;
+    bool fastBilateral_;
+    int gridSpatialSampling_; // Bilateral grid cell size, percent of sigma
+    int gridRangeSampling_;
 
     // UI components
     QWidget* propertiesWidget_;
@@ -60,9 +75,22 @@ private:
     QLabel* xDirectionLabel_;
     QLabel* yDirectionLabel_;
     QLabel* kernelPreviewLabel_;
+    QCheckBox* fastBilateralCheckBox_;
+    QSlider* gridSpatialSlider_;
+    QSlider* gridRangeSlider_;
+    QLabel* gridSpatialLabel_;
+    QLabel* gridRangeLabel_;
+
+    // Directional kernel shared by processing and the preview, rebuilt when its settings change
+    mutable BlurFilters::DirectionalKernel directionalKernel_;
+
+    // Summed-area table of the last box blurred input, keyed by its content hash
+    cv::Mat integralImage_;
+    uint64_t integralKey_;
 
     // Helper methods
-    cv::Mat applyBlur(const cv::Mat& input);
+    cv::Mat applyBlur(const cv::Mat& input, uint64_t inputHash);
+    const BlurFilters::DirectionalKernel& getDirectionalKernel() const;
     void updateKernelPreview();
     QString getKernelString() const;
 };
@@ -1,10 +1,17 @@
 #include "BrightnessContrastNode.h"
+#include "../utils/ImageUtils.h"
 
 BrightnessContrastNode::BrightnessContrastNode()
     : Node("Brightness/Contrast", NodeType::Processing),
       brightness_(0),
       contrast_(1.0),
-      propertiesWidget_(nullptr) {
+      propertiesWidget_(nullptr),
+      brightnessSlider_(nullptr),
+      contrastSlider_(nullptr),
+      brightnessValueLabel_(nullptr),
+      contrastValueLabel_(nullptr),
+      resetBrightnessButton_(nullptr),
+      resetContrastButton_(nullptr) {
     // Add input and output connectors
     addInputConnector("Image");
     addOutputConnector("Image");
@@ -124,24 +131,53 @@ double BrightnessContrastNode::getContrast() const {
     return contrast_;
 }
 
+std::vector<NodeParameter> BrightnessContrastNode::getParameters() const {
+    return {
+        {"brightness", static_cast<double>(brightness_), ""},
+        {"contrast", contrast_, ""}
+    };
+}
+
+void BrightnessContrastNode::setParameters(const std::vector<NodeParameter>& parameters) {
+    for (const NodeParameter& parameter : parameters) {
+        if (parameter.name == "brightness") {
+            setBrightness(static_cast<int>(parameter.value));
+        } else if (parameter.name == "contrast") {
+            setContrast(parameter.value);
+        }
+    }
+}
+
 cv::Mat BrightnessContrastNode::applyBrightnessContrast(const cv::Mat& input) {
     if (input.empty()) {
         return cv::Mat();
     }
     
-    cv::Mat output = input.clone();
-    
     // Convert brightness range (-100 to 100) to pixel values
     double alpha = contrast_;
     int beta = brightness_;
     
+    // 8-bit images map each value through a table computed like convertTo's,
+    // in one pass that keeps RGBA alpha as it is
+    if (input.depth() == CV_8U) {
+        uint8_t table[256];
+        for (int value = 0; value < 256; value++) {
+            table[value] = cv::saturate_cast<uint8_t>(static_cast<float>(value) * static_cast<float>(alpha) + static_cast<float>(beta));
+        }
+        
+        cv::Mat output;
+        ImageUtils::applyLookup(input, output, table, true);
+        return output;
+    }
+    
     // Apply brightness and contrast adjustment
-    if (output.channels() <= 3) {
-        output.convertTo(output, -1, alpha, beta);
+    cv::Mat output;
+    if (input.channels() <= 3) {
+        input.convertTo(output, -1, alpha, beta);
     } else {
         // For RGBA images, preserve alpha channel
         std::vector<cv::Mat> channels;
-        cv::split(output, channels);
+        cv::split(input, channels);
         
         // Apply to RGB channels only
         for (int i = 0; i < 3; i++) {
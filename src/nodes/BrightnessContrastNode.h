@@ -14,6 +14,8 @@ public:
     // Node interface implementation
     void process() override;
     QWidget* createPropertiesWidget() override;
+    std::vector<NodeParameter> getParameters() const override;
+    void setParameters(const std::vector<NodeParameter>& parameters) override;
     
     // Set brightness and contrast values
     void setBrightness(int brightness);
@@ -81,6 +81,20 @@ void ChannelSplitterNode::setGrayscaleMode(bool grayscale) {
     dirty_ = true;
 }
 
+std::vector<NodeParameter> ChannelSplitterNode::getParameters() const {
+    return {
+        {"grayscaleMode", grayscaleMode_ ? 1.0 : 0.0, ""}
+    };
+}
+
+void ChannelSplitterNode::setParameters(const std::vector<NodeParameter>& parameters) {
+    for (const NodeParameter& parameter : parameters) {
+        if (parameter.name == "grayscaleMode") {
+            setGrayscaleMode(parameter.value != 0.0);
+        }
+    }
+}
+
 void ChannelSplitterNode::splitChannels(const cv::Mat& input) {
     if (input.empty()) {
         // Clear all output images
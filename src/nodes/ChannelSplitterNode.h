@@ -13,6 +13,8 @@ public:
     // Node interface implementation
     void process() override;
     QWidget* createPropertiesWidget() override;
+    std::vector<NodeParameter> getParameters() const override;
+    void setParameters(const std::vector<NodeParameter>& parameters) override;
 
     // Getters and setters
     bool getGrayscaleMode() const;
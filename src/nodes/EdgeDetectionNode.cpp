@@ -1,4 +1,7 @@
 #include "EdgeDetectionNode.h"
+#include "../utils/EdgeFilters.h"
+#include "../utils/ImageUtils.h"
+#include <QColorDialog>
 
 EdgeDetectionNode::EdgeDetectionNode()
     : Node("Edge Detection", NodeType::Processing),
@@ -7,7 +10,20 @@ EdgeDetectionNode::EdgeDetectionNode()
       threshold2_(150),
       kernelSize_(3),
       overlayMode_(false),
-      propertiesWidget_(nullptr) {
+      overlayColor_(Qt::green),
+      propertiesWidget_(nullptr),
+      edgeTypeComboBox_(nullptr),
+      threshold1Slider_(nullptr),
+      threshold1Label_(nullptr),
+      threshold2Slider_(nullptr),
+      threshold2Label_(nullptr),
+      kernelSizeComboBox_(nullptr),
+      overlayCheckBox_(nullptr),
+      overlayColorButton_(nullptr),
+      grayKey_(0),
+      blurredKey_(0),
+      gradientKey_(0),
+      magnitudeKey_(0) {
     // Add input and output connectors
     addInputConnector("Image");
     addOutputConnector("Image");
@@ -31,27 +47,36 @@ void EdgeDetectionNode::process() {
 
     // Get the image from the source node
     cv::Mat inputImage = sourceNode->getOutputImage(sourceConnector->getIndex());
+    uint64_t inputHash = sourceNode->getOutputHash(sourceConnector->getIndex());
 
-    // Process the image based on edge detection type
-    cv::Mat outputImage;
-    cv::Mat edgeImage;
-
-    if (edgeType_ == EdgeDetectionType::Sobel) {
-        edgeImage = applySobelEdgeDetection(inputImage);
-    } else { // Canny
-        edgeImage = applyCannyEdgeDetection(inputImage);
-    }
+    // 8-bit images get a packed edge mask. It is passed on as is for grayscale
+    // inputs, painted for the overlay and only expanded for color edge images.
+    if (!inputImage.empty() && inputImage.depth() == CV_8U) {
+        BitMask edges;
+        if (edgeType_ == EdgeDetectionType::Sobel) {
+            edges = applySobelEdgeMask(inputImage, inputHash);
+        } else { // Canny
+            edges = applyCannyEdgeMask(inputImage, inputHash);
+        }
 
-    // Apply overlay if enabled
-    if (overlayMode_) {
-        outputImage = overlayEdges(inputImage, edgeImage);
+        if (overlayMode_) {
+            setOutputImage(overlayEdges(inputImage, edges), 0);
+        } else if (inputImage.channels() == 1) {
+            setOutputMask(edges, 0);
+        } else {
+            setOutputImage(edges.toImage(3), 0);
+        }
     } else {
-        outputImage = edgeImage;
+        // Other depths go through OpenCV and cannot take the overlay
+        cv::Mat outputImage;
+        if (edgeType_ == EdgeDetectionType::Sobel) {
+            outputImage = applySobelEdgeDetection(inputImage);
+        } else { // Canny
+            outputImage = applyCannyEdgeDetection(inputImage);
+        }
+        setOutputImage(outputImage, 0);
     }
 
-    // Set output image
-    setOutputImage(outputImage, 0);
-
     // Mark as processed
     dirty_ = false;
 }
@@ -108,6 +133,9 @@ QWidget* EdgeDetectionNode::createPropertiesWidget() {
         overlayCheckBox_ = new QCheckBox("Overlay edges on original image");
         overlayCheckBox_->setChecked(overlayMode_);
         overlayLayout->addWidget(overlayCheckBox_);
+        overlayColorButton_ = new QPushButton("Overlay Color");
+        overlayColorButton_->setStyleSheet(QString("background-color: %1").arg(overlayColor_.name()));
+        overlayLayout->addWidget(overlayColorButton_);
 
         // Add all groups to main layout
         mainLayout->addWidget(typeGroup);
@@ -154,6 +182,13 @@ QWidget* EdgeDetectionNode::createPropertiesWidget() {
             dirty_ = true;
         });
 
+        connect(overlayColorButton_, &QPushButton::clicked, [this]() {
+            QColor color = QColorDialog::getColor(overlayColor_, propertiesWidget_, "Overlay Color");
+            if (color.isValid()) {
+                setOverlayColor(color);
+            }
+        });
+
         // Initialize UI state based on edge type
         if (edgeType_ == EdgeDetectionType::Sobel) {
             threshold2Slider_->setEnabled(false);
@@ -235,6 +270,62 @@ void EdgeDetectionNode::setOverlayMode(bool overlay) {
     dirty_ = true;
 }
 
+QColor EdgeDetectionNode::getOverlayColor() const {
+    return overlayColor_;
+}
+
+void EdgeDetectionNode::setOverlayColor(const QColor& color) {
+    overlayColor_ = color;
+    if (overlayColorButton_) {
+        overlayColorButton_->setStyleSheet(QString("background-color: %1").arg(overlayColor_.name()));
+    }
+    dirty_ = true;
+}
+
+std::vector<NodeParameter> EdgeDetectionNode::getParameters() const {
+    return {
+        {"edgeType", static_cast<double>(edgeType_), ""},
+        {"threshold1", static_cast<double>(threshold1_), ""},
+        {"threshold2", static_cast<double>(threshold2_), ""},
+        {"kernelSize", static_cast<double>(kernelSize_), ""},
+        {"overlayMode", overlayMode_ ? 1.0 : 0.0, ""},
+        {"overlayColor", 0.0, overlayColor_.name().toStdString()}
+    };
+}
+
+void EdgeDetectionNode::setParameters(const std::vector<NodeParameter>& parameters) {
+    for (const NodeParameter& parameter : parameters) {
+        if (parameter.name == "edgeType") {
+            setEdgeType(static_cast<EdgeDetectionType>(static_cast<int>(parameter.value)));
+        } else if (parameter.name == "threshold1") {
+            setThreshold1(static_cast<int>(parameter.value));
+        } else if (parameter.name == "threshold2") {
+            setThreshold2(static_cast<int>(parameter.value));
+        } else if (parameter.name == "kernelSize") {
+            setKernelSize(static_cast<int>(parameter.value));
+        } else if (parameter.name == "overlayMode") {
+            setOverlayMode(parameter.value != 0.0);
+        } else if (parameter.name == "overlayColor") {
+            QColor color(QString::fromStdString(parameter.text));
+            if (color.isValid()) {
+                setOverlayColor(color);
+            }
+        }
+    }
+}
+
+BitMask EdgeDetectionNode::applySobelEdgeMask(const cv::Mat& input, uint64_t inputHash) {
+    // The gradient magnitude from the fused kernel is kept, so a threshold
+    // change only packs it again
+    uint64_t magnitudeKey = ImageUtils::combineHash(inputHash, static_cast<uint64_t>(kernelSize_));
+    if (!isCached(magnitudeKey, magnitudeKey_) || magnitude_.empty()) {
+        EdgeFilters::sobelMagnitude(input, magnitude_, kernelSize_);
+        magnitudeKey_ = magnitudeKey;
+    }
+
+    return BitMask::fromImage(magnitude_, threshold1_);
+}
+
 cv::Mat EdgeDetectionNode::applySobelEdgeDetection(const cv::Mat& input) {
     if (input.empty()) {
         return cv::Mat();
@@ -280,6 +371,41 @@ cv::Mat EdgeDetectionNode::applySobelEdgeDetection(const cv::Mat& input) {
     return edges;
 }
 
+BitMask EdgeDetectionNode::applyCannyEdgeMask(const cv::Mat& input, uint64_t inputHash) {
+    // Each stage is redone only when something upstream of it changed
+    uint64_t grayKey = inputHash;
+    if (!isCached(grayKey, grayKey_) || gray_.empty()) {
+        // Convert to grayscale if needed
+        if (input.channels() > 1) {
+            cv::cvtColor(input, gray_, cv::COLOR_BGR2GRAY);
+        } else {
+            gray_ = input;
+        }
+        grayKey_ = grayKey;
+    }
+
+    uint64_t blurredKey = ImageUtils::combineHash(grayKey, static_cast<uint64_t>(kernelSize_));
+    if (!isCached(blurredKey, blurredKey_) || blurred_.empty()) {
+        // Apply Gaussian blur to reduce noise
+        cv::GaussianBlur(gray_, blurred_, cv::Size(kernelSize_, kernelSize_), 0);
+        blurredKey_ = blurredKey;
+    }
+
+    // Gradients as cv::Canny computes them internally, so only non-maximum
+    // suppression and hysteresis run again when a threshold moves. The 7x7
+    // Sobel is scaled down by 16 to fit 16 bits, and the thresholds with it.
+    double scale = kernelSize_ == 7 ? 1.0 / 16.0 : 1.0;
+    if (!isCached(blurredKey, gradientKey_) || gradientX_.empty()) {
+        cv::Sobel(blurred_, gradientX_, CV_16S, 1, 0, kernelSize_, scale, 0, cv::BORDER_REPLICATE);
+        cv::Sobel(blurred_, gradientY_, CV_16S, 0, 1, kernelSize_, scale, 0, cv::BORDER_REPLICATE);
+        gradientKey_ = blurredKey;
+    }
+
+    BitMask edges;
+    EdgeFilters::canny(gradientX_, gradientY_, edges, threshold1_ * scale, threshold2_ * scale);
+    return edges;
+}
+
 cv::Mat EdgeDetectionNode::applyCannyEdgeDetection(const cv::Mat& input) {
     if (input.empty()) {
         return cv::Mat();
@@ -311,46 +437,26 @@ cv::Mat EdgeDetectionNode::applyCannyEdgeDetection(const cv::Mat& input) {
     return edges;
 }
 
-cv::Mat EdgeDetectionNode::overlayEdges(const cv::Mat& original, const cv::Mat& edges) {
+bool EdgeDetectionNode::isCached(uint64_t key, uint64_t cachedKey) {
+    // A zero hash means the input content is unknown
+    return key != 0 && key == cachedKey;
+}
+
+cv::Mat EdgeDetectionNode::overlayEdges(const cv::Mat& original, const BitMask& edges) {
     if (original.empty() || edges.empty()) {
         return cv::Mat();
     }
 
-    // Ensure both images have the same size and type
-    cv::Mat edgesMat;
-    if (original.channels() != edges.channels()) {
-        if (original.channels() > 1) {
-            cv::cvtColor(edges, edgesMat, cv::COLOR_GRAY2BGR);
-        } else {
-            cv::cvtColor(edges, edgesMat, cv::COLOR_BGR2GRAY);
-        }
+    // Color per image channel, grayscale images are painted with the color's brightness
+    cv::Scalar color;
+    if (original.channels() == 1) {
+        color = cv::Scalar(overlayColor_.value());
     } else {
-        edgesMat = edges.clone();
-    }
-
-    // Create output image
-    cv::Mat output = original.clone();
-
-    // Overlay edges (green color)
-    for (int y = 0; y < output.rows; y++) {
-        for (int x = 0; x < output.cols; x++) {
-            if (original.channels() > 1) {
-                // For color images
-                if (edgesMat.at<cv::Vec3b>(y, x)[0] > 0) {
-                    // Edge detected, overlay with green
-                    output.at<cv::Vec3b>(y, x)[0] = 0;   // B
-                    output.at<cv::Vec3b>(y, x)[1] = 255; // G
-                    output.at<cv::Vec3b>(y, x)[2] = 0;   // R
-                }
-            } else {
-                // For grayscale images
-                if (edgesMat.at<uchar>(y, x) > 0) {
-                    // Edge detected, set to white
-                    output.at<uchar>(y, x) = 255;
-                }
-            }
-        }
+        color = cv::Scalar(overlayColor_.blue(), overlayColor_.green(), overlayColor_.red(), 255);
     }
 
+    // Masked write straight from the packed edges
+    cv::Mat output;
+    EdgeFilters::overlayEdges(original, edges, output, color);
     return output;
 }
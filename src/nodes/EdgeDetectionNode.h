@@ -9,6 +9,7 @@
 #include <QComboBox>
 #include <QGroupBox>
 #include <QCheckBox>
+#include <QColor>
 
 enum class EdgeDetectionType {
     Sobel,
@@ -23,6 +24,8 @@ public:
     // Node interface implementation
     void process() override;
     QWidget* createPropertiesWidget() override;
+    std::vector<NodeParameter> getParameters() const override;
+    void setParameters(const std::vector<NodeParameter>& parameters) override;
 
     // Getters and setters
     EdgeDetectionType getEdgeType() const;
@@ -40,6 +43,9 @@ public:
     bool getOverlayMode() const;
     void setOverlayMode(bool overlay);
 
+    QColor getOverlayColor() const;
+    void setOverlayColor(const QColor& color);
+
 private:
     // Processing parameters
     EdgeDetectionType edgeType_;
@@ -47,6 +53,7 @@ private:
     int threshold2_;
     int kernelSize_;
     bool overlayMode_;
+    QColor overlayColor_;
 
     // UI components
     QWidget* propertiesWidget_;
@@ -57,9 +64,24 @@ private:
     QLabel* threshold2Label_;
     QComboBox* kernelSizeComboBox_;
     QCheckBox* overlayCheckBox_;
+    QPushButton* overlayColorButton_;
+
+    // Intermediate stages of 8-bit inputs, each keyed by the input hash and the settings it depends on
+    cv::Mat gray_;
+    cv::Mat blurred_;
+    cv::Mat gradientX_;
+    cv::Mat gradientY_;
+    cv::Mat magnitude_;
+    uint64_t grayKey_;
+    uint64_t blurredKey_;
+    uint64_t gradientKey_;
+    uint64_t magnitudeKey_;
 
     // Helper methods
+    BitMask applySobelEdgeMask(const cv::Mat& input, uint64_t inputHash);
+    BitMask applyCannyEdgeMask(const cv::Mat& input, uint64_t inputHash);
     cv::Mat applySobelEdgeDetection(const cv::Mat& input);
     cv::Mat applyCannyEdgeDetection(const cv::Mat& input);
-    cv::Mat overlayEdges(const cv::Mat& original, const cv::Mat& edges);
+    static bool isCached(uint64_t key, uint64_t cachedKey);
+    cv::Mat overlayEdges(const cv::Mat& original, const BitMask& edges);
 };
@@ -150,6 +150,24 @@ std::string InputNode::getImageInfo() const {
     return ss.str();
 }
 
+const std::string& InputNode::getImagePath() const {
+    return imagePath_;
+}
+
+std::vector<NodeParameter> InputNode::getParameters() const {
+    return {
+        {"imagePath", 0.0, imagePath_}
+    };
+}
+
+void InputNode::setParameters(const std::vector<NodeParameter>& parameters) {
+    for (const NodeParameter& parameter : parameters) {
+        if (parameter.name == "imagePath" && !parameter.text.empty()) {
+            loadImage(parameter.text);
+        }
+    }
+}
+
 void InputNode::updateImageInfo() {
     if (imageInfoLabel_) {
         imageInfoLabel_->setText(QString::fromStdString(getImageInfo()));
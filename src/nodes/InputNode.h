@@ -16,12 +16,15 @@ public:
     void process() override;
     QWidget* createPropertiesWidget() override;
     bool isReady() const override;
+    std::vector<NodeParameter> getParameters() const override;
+    void setParameters(const std::vector<NodeParameter>& parameters) override;
     
     // Load image from file
     bool loadImage(const std::string& filePath);
     
     // Get image info
     std::string getImageInfo() const;
+    const std::string& getImagePath() const;
     
 private:
     std::string imagePath_;
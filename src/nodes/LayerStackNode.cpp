@@ -0,0 +1,284 @@
+#include "LayerStackNode.h"
+#include "../connections/NodeConnector.h"
+#include "../connections/Connection.h"
+#include "../utils/ImageUtils.h"
+#include "../utils/ParallelUtils.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Bytes of a row composited through every layer at once, small enough to stay in L1
+const size_t kTileBytes = 8 * 1024;
+
+const char* const kBlendModeNames[] = {
+    "Normal", "Multiply", "Screen", "Overlay", "Difference", "Addition", "Subtract", "Darken", "Lighten"
+};
+
+// Color conversion between the 8-bit channel layouts, -1 if none is needed
+int conversionCode(int fromChannels, int toChannels) {
+    if (fromChannels == 1 && toChannels == 3) return cv::COLOR_GRAY2BGR;
+    if (fromChannels == 1 && toChannels == 4) return cv::COLOR_GRAY2BGRA;
+    if (fromChannels == 3 && toChannels == 1) return cv::COLOR_BGR2GRAY;
+    if (fromChannels == 3 && toChannels == 4) return cv::COLOR_BGR2BGRA;
+    if (fromChannels == 4 && toChannels == 1) return cv::COLOR_BGRA2GRAY;
+    if (fromChannels == 4 && toChannels == 3) return cv::COLOR_BGRA2BGR;
+    return -1;
+}
+
+} // namespace
+
+LayerStackNode::LayerStackNode()
+    : Node("Layer Stack", NodeType::Processing),
+      propertiesWidget_(nullptr) {
+    layerModes_.fill(BlendMode::Normal);
+    layerOpacities_.fill(100);
+    modeComboBoxes_.fill(nullptr);
+    opacitySliders_.fill(nullptr);
+    opacityLabels_.fill(nullptr);
+    layerKeys_.fill(0);
+
+    // Add input connectors, the base is at the bottom of the stack
+    addInputConnector("Base");
+    for (int i = 0; i < kLayerCount; i++) {
+        addInputConnector("Layer " + std::to_string(i + 1));
+    }
+
+    // Add output connector
+    addOutputConnector("Image");
+}
+
+LayerStackNode::~LayerStackNode() {
+    // Properties widget will be deleted by the Qt parent-child mechanism
+}
+
+void LayerStackNode::process() {
+    if (!isReady()) {
+        setOutputImage(cv::Mat(), 0);
+        return;
+    }
+
+    uint64_t baseHash = 0;
+    cv::Mat base = getInputImage(0, baseHash);
+
+    // Only 8-bit images are composited, anything else passes the base through
+    if (base.depth() != CV_8U) {
+        setOutputImage(base, 0);
+        dirty_ = false;
+        return;
+    }
+
+    // Conform each connected layer only when it or the base changed
+    for (int layer = 0; layer < kLayerCount; layer++) {
+        uint64_t hash = 0;
+        cv::Mat image = getInputImage(layer + 1, hash);
+        conformLayer(layer, image, hash, base);
+    }
+
+    // Process the images
+    cv::Mat outputImage = compositeLayers(base);
+
+    // Set output image
+    setOutputImage(outputImage, 0);
+
+    // Mark as processed
+    dirty_ = false;
+}
+
+QWidget* LayerStackNode::createPropertiesWidget() {
+    if (!propertiesWidget_) {
+        propertiesWidget_ = new QWidget();
+        QVBoxLayout* mainLayout = new QVBoxLayout(propertiesWidget_);
+
+        // One group per layer, top of the stack first
+        for (int layer = kLayerCount - 1; layer >= 0; layer--) {
+            QGroupBox* layerGroup = new QGroupBox("Layer " + QString::number(layer + 1));
+            QVBoxLayout* layerLayout = new QVBoxLayout(layerGroup);
+
+            // Blend mode selection
+            QComboBox* modeComboBox = new QComboBox();
+            for (int mode = 0; mode <= static_cast<int>(BlendMode::Lighten); mode++) {
+                modeComboBox->addItem(kBlendModeNames[mode], mode);
+            }
+            modeComboBox->setCurrentIndex(static_cast<int>(layerModes_[layer]));
+            layerLayout->addWidget(modeComboBox);
+
+            // Opacity control
+            QHBoxLayout* opacityLayout = new QHBoxLayout();
+            QSlider* opacitySlider = new QSlider(Qt::Horizontal);
+            opacitySlider->setRange(0, 100);
+            opacitySlider->setValue(layerOpacities_[layer]);
+            QLabel* opacityLabel = new QLabel(QString::number(layerOpacities_[layer]) + "%");
+            opacityLayout->addWidget(opacitySlider);
+            opacityLayout->addWidget(opacityLabel);
+            layerLayout->addLayout(opacityLayout);
+
+            mainLayout->addWidget(layerGroup);
+
+            modeComboBoxes_[layer] = modeComboBox;
+            opacitySliders_[layer] = opacitySlider;
+            opacityLabels_[layer] = opacityLabel;
+
+            // Connect signals and slots
+            connect(modeComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged), [this, layer](int index) {
+                layerModes_[layer] = static_cast<BlendMode>(index);
+                dirty_ = true;
+            });
+
+            connect(opacitySlider, &QSlider::valueChanged, [this, layer](int value) {
+                layerOpacities_[layer] = value;
+                opacityLabels_[layer]->setText(QString::number(value) + "%");
+                dirty_ = true;
+            });
+        }
+
+        mainLayout->addStretch();
+    }
+
+    return propertiesWidget_;
+}
+
+bool LayerStackNode::isReady() const {
+    // The base must be connected and have an image, layers are optional
+    if (inputConnectors_.empty() || inputConnectors_[0]->getConnections().empty()) {
+        return false;
+    }
+
+    NodeConnector* baseSourceConnector = inputConnectors_[0]->getConnections()[0]->getSource();
+    return baseSourceConnector->getParentNode()->hasOutput(baseSourceConnector->getIndex());
+}
+
+BlendMode LayerStackNode::getLayerMode(int layer) const {
+    return layer >= 0 && layer < kLayerCount ? layerModes_[layer] : BlendMode::Normal;
+}
+
+void LayerStackNode::setLayerMode(int layer, BlendMode mode) {
+    if (layer < 0 || layer >= kLayerCount) return;
+
+    layerModes_[layer] = mode;
+    if (modeComboBoxes_[layer]) {
+        modeComboBoxes_[layer]->setCurrentIndex(static_cast<int>(mode));
+    }
+    dirty_ = true;
+}
+
+int LayerStackNode::getLayerOpacity(int layer) const {
+    return layer >= 0 && layer < kLayerCount ? layerOpacities_[layer] : 0;
+}
+
+void LayerStackNode::setLayerOpacity(int layer, int opacity) {
+    if (layer < 0 || layer >= kLayerCount) return;
+
+    layerOpacities_[layer] = std::max(0, std::min(100, opacity));
+    if (opacitySliders_[layer]) {
+        opacitySliders_[layer]->setValue(layerOpacities_[layer]);
+    }
+    dirty_ = true;
+}
+
+std::vector<NodeParameter> LayerStackNode::getParameters() const {
+    std::vector<NodeParameter> parameters;
+    for (int layer = 0; layer < kLayerCount; layer++) {
+        std::string prefix = "layer" + std::to_string(layer + 1);
+        parameters.push_back({prefix + "Mode", static_cast<double>(layerModes_[layer]), ""});
+        parameters.push_back({prefix + "Opacity", static_cast<double>(layerOpacities_[layer]), ""});
+    }
+    return parameters;
+}
+
+void LayerStackNode::setParameters(const std::vector<NodeParameter>& parameters) {
+    for (const NodeParameter& parameter : parameters) {
+        for (int layer = 0; layer < kLayerCount; layer++) {
+            std::string prefix = "layer" + std::to_string(layer + 1);
+            if (parameter.name == prefix + "Mode") {
+                setLayerMode(layer, static_cast<BlendMode>(static_cast<int>(parameter.value)));
+            } else if (parameter.name == prefix + "Opacity") {
+                setLayerOpacity(layer, static_cast<int>(parameter.value));
+            }
+        }
+    }
+}
+
+cv::Mat LayerStackNode::getInputImage(int index, uint64_t& hash) const {
+    if (inputConnectors_[index]->getConnections().empty()) {
+        hash = 0;
+        return cv::Mat();
+    }
+
+    NodeConnector* sourceConnector = inputConnectors_[index]->getConnections()[0]->getSource();
+    Node* sourceNode = sourceConnector->getParentNode();
+    hash = sourceNode->getOutputHash(sourceConnector->getIndex());
+    return sourceNode->getOutputImage(sourceConnector->getIndex());
+}
+
+void LayerStackNode::conformLayer(int layer, const cv::Mat& image, uint64_t hash, const cv::Mat& base) {
+    if (image.empty()) {
+        conformedLayers_[layer] = cv::Mat();
+        layerKeys_[layer] = 0;
+        return;
+    }
+
+    // The layer is matched to the base's size and type
+    uint64_t key = ImageUtils::combineHash(hash, static_cast<uint64_t>(base.rows));
+    key = ImageUtils::combineHash(key, static_cast<uint64_t>(base.cols));
+    key = ImageUtils::combineHash(key, static_cast<uint64_t>(base.type()));
+    if (key == layerKeys_[layer] && !conformedLayers_[layer].empty()) {
+        return;
+    }
+
+    cv::Mat conformed = image;
+    try {
+        // Resize layer to match base size
+        if (conformed.size() != base.size()) {
+            cv::resize(conformed, conformed, base.size());
+        }
+
+        // Match depth and channels
+        if (conformed.depth() != CV_8U) {
+            conformed.convertTo(conformed, CV_8U);
+        }
+        int code = conversionCode(conformed.channels(), base.channels());
+        if (code >= 0) {
+            cv::cvtColor(conformed, conformed, code);
+        }
+    } catch (const cv::Exception&) {
+        conformed = cv::Mat();
+    }
+
+    // Layers that still do not match are left out of the stack
+    conformedLayers_[layer] = conformed.type() == base.type() ? conformed : cv::Mat();
+    layerKeys_[layer] = key;
+}
+
+cv::Mat LayerStackNode::compositeLayers(const cv::Mat& base) {
+    // Layers taking part in the composite, bottom to top
+    std::vector<int> activeLayers;
+    for (int layer = 0; layer < kLayerCount; layer++) {
+        if (!conformedLayers_[layer].empty()) {
+            activeLayers.push_back(layer);
+        }
+    }
+
+    cv::Mat result(base.size(), base.type());
+    size_t rowBytes = base.cols * base.elemSize();
+    bool keepAlpha = base.channels() == 4;
+
+    // Each tile of a row is copied from the base once and then blended with every
+    // layer in place while it is in cache, instead of one full pass per layer
+    ParallelUtils::parallelFor(base.rows, ParallelUtils::stripeRows(rowBytes), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            uint8_t* output = result.ptr(y);
+            for (size_t offset = 0; offset < rowBytes; offset += kTileBytes) {
+                size_t count = std::min(kTileBytes, rowBytes - offset);
+                std::memcpy(output + offset, base.ptr(y) + offset, count);
+
+                for (int layer : activeLayers) {
+                    BlendKernels::blendRow(layerModes_[layer], conformedLayers_[layer].ptr(y) + offset,
+                                           output + offset, output + offset, count, layerOpacities_[layer], keepAlpha);
+                }
+            }
+        }
+    });
+
+    return result;
+}
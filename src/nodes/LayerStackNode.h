@@ -0,0 +1,55 @@
+#pragma once
+
+#include "Node.h"
+#include "../utils/BlendKernels.h"
+#include <QSlider>
+#include <QLabel>
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QComboBox>
+#include <QGroupBox>
+#include <array>
+
+// Composites a base image and up to seven layers, bottom to top, each with
+// its own blend mode and opacity. Unconnected layers are skipped.
+class LayerStackNode : public Node {
+public:
+    static const int kLayerCount = 7;
+
+    LayerStackNode();
+    ~LayerStackNode();
+
+    // Node interface implementation
+    void process() override;
+    QWidget* createPropertiesWidget() override;
+    bool isReady() const override;
+    std::vector<NodeParameter> getParameters() const override;
+    void setParameters(const std::vector<NodeParameter>& parameters) override;
+
+    // Getters and setters, layers are numbered from 0 above the base
+    BlendMode getLayerMode(int layer) const;
+    void setLayerMode(int layer, BlendMode mode);
+
+    int getLayerOpacity(int layer) const;
+    void setLayerOpacity(int layer, int opacity);
+
+private:
+    // Processing parameters
+    std::array<BlendMode, kLayerCount> layerModes_;
+    std::array<int, kLayerCount> layerOpacities_; // 0-100
+
+    // UI components
+    QWidget* propertiesWidget_;
+    std::array<QComboBox*, kLayerCount> modeComboBoxes_;
+    std::array<QSlider*, kLayerCount> opacitySliders_;
+    std::array<QLabel*, kLayerCount> opacityLabels_;
+
+    // Layers conformed to the base size and type, reused until a layer or the base changes
+    std::array<cv::Mat, kLayerCount> conformedLayers_;
+    std::array<uint64_t, kLayerCount> layerKeys_;
+
+    // Helper methods
+    cv::Mat getInputImage(int index, uint64_t& hash) const;
+    void conformLayer(int layer, const cv::Mat& image, uint64_t hash, const cv::Mat& base);
+    cv::Mat compositeLayers(const cv::Mat& base);
+};
@@ -1,12 +1,13 @@
 #include "Node.h"
 #include "../connections/NodeConnector.h"
 #include "../connections/Connection.h"
+#include "../utils/ImageUtils.h"
 #include <QApplication>
 
 int Node::nextId_ = 0;
 
 Node::Node(const std::string& name, NodeType type)
-    : name_(name), type_(type), id_(nextId_++), dirty_(true) {
+    : inputSignature_(0), name_(name), typeName_(name), type_(type), id_(nextId_++), dirty_(true) {
     setFlag(QGraphicsItem::ItemIsMovable);
     setFlag(QGraphicsItem::ItemIsSelectable);
     setFlag(QGraphicsItem::ItemSendsGeometryChanges);
@@ -38,6 +39,8 @@ void Node::addOutputConnector(const std::string& name) {
     
     // Add a placeholder for the output image
     outputImages_.push_back(cv::Mat());
+    outputMasks_.push_back(BitMask());
+    outputHashes_.push_back(ImageUtils::hashImage(cv::Mat()));
     
     // Position the connector
     const float connectorSpacing = 25.0f;
@@ -160,6 +163,10 @@ bool Node::isConnected(Node* target) const {
 
 cv::Mat Node::getOutputImage(int outputIndex) const {
     if (outputIndex >= 0 && outputIndex < outputImages_.size()) {
+        // Masks become 8-bit only where a consumer needs pixels
+        if (outputImages_[outputIndex].empty() && !outputMasks_[outputIndex].empty()) {
+            outputImages_[outputIndex] = outputMasks_[outputIndex].toImage();
+        }
         return outputImages_[outputIndex];
     }
     return cv::Mat();
@@ -168,7 +175,43 @@ cv::Mat Node::getOutputImage(int outputIndex) const {
 void Node::setOutputImage(const cv::Mat& image, int outputIndex) {
     if (outputIndex >= 0 && outputIndex < outputImages_.size()) {
         outputImages_[outputIndex] = image.clone();
+        outputMasks_[outputIndex] = BitMask();
+        outputHashes_[outputIndex] = ImageUtils::hashImage(outputImages_[outputIndex]);
+    }
+}
+
+const BitMask& Node::getOutputMask(int outputIndex) const {
+    static const BitMask emptyMask;
+    if (outputIndex >= 0 && outputIndex < outputMasks_.size()) {
+        return outputMasks_[outputIndex];
     }
+    return emptyMask;
+}
+
+void Node::setOutputMask(const BitMask& mask, int outputIndex) {
+    if (outputIndex >= 0 && outputIndex < outputMasks_.size()) {
+        outputMasks_[outputIndex] = mask;
+        outputImages_[outputIndex] = cv::Mat();
+        outputHashes_[outputIndex] = mask.hash();
+    }
+}
+
+bool Node::isMaskOutput(int outputIndex) const {
+    return outputIndex >= 0 && outputIndex < outputMasks_.size() && !outputMasks_[outputIndex].empty();
+}
+
+bool Node::hasOutput(int outputIndex) const {
+    if (outputIndex >= 0 && outputIndex < outputImages_.size()) {
+        return !outputImages_[outputIndex].empty() || !outputMasks_[outputIndex].empty();
+    }
+    return false;
+}
+
+uint64_t Node::getOutputHash(int outputIndex) const {
+    if (outputIndex >= 0 && outputIndex < outputHashes_.size()) {
+        return outputHashes_[outputIndex];
+    }
+    return 0;
 }
 
 bool Node::isReady() const {
@@ -183,7 +226,7 @@ bool Node::isReady() const {
             Node* sourceNode = connection->getSource()->getParentNode();
             int sourceIndex = connection->getSource()->getIndex();
             
-            if (sourceNode->getOutputImage(sourceIndex).empty()) {
+            if (!sourceNode->hasOutput(sourceIndex)) {
                 return false;
             }
         }
@@ -192,6 +235,15 @@ bool Node::isReady() const {
     return true;
 }
 
+std::vector<NodeParameter> Node::getParameters() const {
+    // Nodes without settings have nothing to persist
+    return {};
+}
+
+void Node::setParameters(const std::vector<NodeParameter>& parameters) {
+    // Nodes without settings ignore stored parameters
+}
+
 void Node::mousePressEvent(QGraphicsSceneMouseEvent* event) {
     if (event->button() == Qt::LeftButton) {
         dragOffset_ = event->pos();
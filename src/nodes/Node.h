@@ -9,6 +9,8 @@
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
 #include <QGraphicsSceneMouseEvent>
+#include <QImage>
+#include "../utils/BitMask.h"
 
 class NodeConnector;
 class Connection;
@@ -26,6 +28,13 @@ enum class ConnectorType {
     Output
 };
 
+// Named node setting persisted in project files
+struct NodeParameter {
+    std::string name;
+    double value;
+    std::string text;
+};
+
 // Node Class - Base class for all nodes
 class Node : public QGraphicsItem {
 public:
@@ -48,6 +57,8 @@ public:
     
     // Getters and setters
     const std::string& getName() const { return name_; }
+    void setName(const std::string& name) { name_ = name; }
+    const std::string& getTypeName() const { return typeName_; }
     NodeType getType() const { return type_; }
     void setPosition(const QPointF& pos);
     QPointF getPosition() const;
@@ -61,9 +72,38 @@ public:
     cv::Mat getOutputImage(int outputIndex = 0) const;
     void setOutputImage(const cv::Mat& image, int outputIndex = 0);
     
+    // Binary results can be stored packed. getOutputImage expands them to an
+    // 8-bit 0/255 image on first use, mask-aware consumers read the bits directly.
+    const BitMask& getOutputMask(int outputIndex = 0) const;
+    void setOutputMask(const BitMask& mask, int outputIndex = 0);
+    bool isMaskOutput(int outputIndex = 0) const;
+    
+    // Whether an output holds an image or a mask, without expanding masks
+    bool hasOutput(int outputIndex = 0) const;
+    
+    // Content hash of each output, updated whenever the output image is set
+    uint64_t getOutputHash(int outputIndex = 0) const;
+    
+    // Hash of the parameters and input contents the outputs were computed from, 0 if unknown
+    uint64_t getInputSignature() const { return inputSignature_; }
+    void setInputSignature(uint64_t signature) { inputSignature_ = signature; }
+    
     // Check if node is ready to process
     virtual bool isReady() const;
     
+    // Dirty state, dirty nodes are reprocessed by the graph manager
+    bool isDirty() const { return dirty_; }
+    void markDirty() { dirty_ = true; }
+    void markClean() { dirty_ = false; }
+    
+    // Preview shown on the canvas until the node is processed
+    const QImage& getThumbnail() const { return thumbnail_; }
+    void setThumbnail(const QImage& thumbnail) { thumbnail_ = thumbnail; }
+    
+    // Parameter serialization, names must be stable for a given node type
+    virtual std::vector<NodeParameter> getParameters() const;
+    virtual void setParameters(const std::vector<NodeParameter>& parameters);
+    
     // Node ID for tracking
     int getId() const { return id_; }
 
@@ -72,13 +112,18 @@ protected:
     std::vector<NodeConnector*> inputConnectors_;
     std::vector<NodeConnector*> outputConnectors_;
     
-    // Result images for each output connector
-    std::vector<cv::Mat> outputImages_;
+    // Result images for each output connector, mask outputs are expanded into them on demand
+    mutable std::vector<cv::Mat> outputImages_;
+    std::vector<BitMask> outputMasks_;
+    std::vector<uint64_t> outputHashes_;
+    uint64_t inputSignature_;
     
     std::string name_;
+    std::string typeName_; // Registry key, fixed at construction
     NodeType type_;
     int id_;
     bool dirty_; // Whether the node needs reprocessing
+    QImage thumbnail_;
     
     // Graphics item methods
     void mousePressEvent(QGraphicsSceneMouseEvent* event) override;
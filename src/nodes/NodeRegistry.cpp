@@ -0,0 +1,54 @@
+#include "NodeRegistry.h"
+#include "Node.h"
+#include "InputNode.h"
+#include "OutputNode.h"
+#include "BrightnessContrastNode.h"
+#include "BlurNode.h"
+#include "ThresholdNode.h"
+#include "EdgeDetectionNode.h"
+#include "BlendNode.h"
+#include "ChannelSplitterNode.h"
+#include "LayerStackNode.h"
+
+NodeRegistry& NodeRegistry::instance() {
+    static NodeRegistry registry;
+    return registry;
+}
+
+NodeRegistry::NodeRegistry() {
+    // Built-in node types, keyed by the name each node is constructed with
+    registerType("Image Input", []() { return new InputNode(); });
+    registerType("Output", []() { return new OutputNode(); });
+    registerType("Brightness/Contrast", []() { return new BrightnessContrastNode(); });
+    registerType("Blur", []() { return new BlurNode(); });
+    registerType("Threshold", []() { return new ThresholdNode(); });
+    registerType("Edge Detection", []() { return new EdgeDetectionNode(); });
+    registerType("Blend", []() { return new BlendNode(); });
+    registerType("Channel Splitter", []() { return new ChannelSplitterNode(); });
+    registerType("Layer Stack", []() { return new LayerStackNode(); });
+}
+
+void NodeRegistry::registerType(const std::string& typeName, Factory factory) {
+    factories_[typeName] = std::move(factory);
+}
+
+Node* NodeRegistry::create(const std::string& typeName) const {
+    auto it = factories_.find(typeName);
+    if (it == factories_.end()) {
+        return nullptr;
+    }
+    return it->second();
+}
+
+bool NodeRegistry::contains(const std::string& typeName) const {
+    return factories_.find(typeName) != factories_.end();
+}
+
+std::vector<std::string> NodeRegistry::getTypeNames() const {
+    std::vector<std::string> typeNames;
+    typeNames.reserve(factories_.size());
+    for (const auto& pair : factories_) {
+        typeNames.push_back(pair.first);
+    }
+    return typeNames;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class Node;
+
+// NodeRegistry - Creates nodes from their type name, used by project loading
+class NodeRegistry {
+public:
+    using Factory = std::function<Node*()>;
+
+    static NodeRegistry& instance();
+
+    // Register a factory for a node type, replacing any previous registration
+    void registerType(const std::string& typeName, Factory factory);
+
+    // Create a node of the given type, returns nullptr for unknown types
+    Node* create(const std::string& typeName) const;
+
+    bool contains(const std::string& typeName) const;
+    std::vector<std::string> getTypeNames() const;
+
+private:
+    NodeRegistry();
+
+    std::unordered_map<std::string, Factory> factories_;
+};
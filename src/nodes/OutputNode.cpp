@@ -197,6 +197,23 @@ void OutputNode::setQuality(int quality) {
     }
 }
 
+std::vector<NodeParameter> OutputNode::getParameters() const {
+    return {
+        {"format", static_cast<double>(format_), ""},
+        {"quality", static_cast<double>(quality_), ""}
+    };
+}
+
+void OutputNode::setParameters(const std::vector<NodeParameter>& parameters) {
+    for (const NodeParameter& parameter : parameters) {
+        if (parameter.name == "format") {
+            setFormat(static_cast<ImageFormat>(static_cast<int>(parameter.value)));
+        } else if (parameter.name == "quality") {
+            setQuality(static_cast<int>(parameter.value));
+        }
+    }
+}
+
 void OutputNode::updatePreview() {
     if (!previewView_ || processedImage_.empty()) {
         return;
@@ -16,6 +16,8 @@ public:
     // Node interface implementation
     void process() override;
     QWidget* createPropertiesWidget() override;
+    std::vector<NodeParameter> getParameters() const override;
+    void setParameters(const std::vector<NodeParameter>& parameters) override;
     
     // Save output image to file
     bool saveImage(const std::string& filePath);
@@ -1,7 +1,22 @@
 #include "ThresholdNode.h"
+#include "../utils/ThresholdFilters.h"
 #include <QCheckBox>
 #include <QGridLayout>
 #include <QGroupBox>
+#include <algorithm>
+
+namespace {
+
+// Mean blocks cost the same at any size, so their range covers document scans.
+// Gaussian blocks go through cv::adaptiveThreshold, whose cost grows with the block.
+const int kMaxMeanBlockSize = 301;
+const int kMaxGaussianBlockSize = 51;
+
+int maxAdaptiveBlockSize(AdaptiveMethod method) {
+    return method == AdaptiveMethod::Mean ? kMaxMeanBlockSize : kMaxGaussianBlockSize;
+}
+
+} // namespace
 
 ThresholdNode::ThresholdNode()
     : Node("Threshold", NodeType::Processing),
@@ -9,8 +24,22 @@ ThresholdNode::ThresholdNode()
       thresholdType_(ThresholdType::Binary),
       adaptiveBlockSize_(3),
       adaptiveConstant_(5),
+      adaptiveMethod_(AdaptiveMethod::Gaussian),
+      singleChannelOutput_(false),
       histogramMax_(0),
-      propertiesWidget_(nullptr) {
+      grayscaleKey_(0),
+      propertiesWidget_(nullptr),
+      thresholdSlider_(nullptr),
+      thresholdValueLabel_(nullptr),
+      thresholdTypeComboBox_(nullptr),
+      histogramPlot_(nullptr),
+      adaptiveBlockSizeSlider_(nullptr),
+      adaptiveBlockSizeLabel_(nullptr),
+      adaptiveConstantSlider_(nullptr),
+      adaptiveConstantLabel_(nullptr),
+      adaptiveMethodComboBox_(nullptr),
+      singleChannelCheckBox_(nullptr),
+      adaptiveGroup_(nullptr) {
     // Add input and output connectors
     addInputConnector("Image");
     addOutputConnector("Image");
@@ -37,9 +66,22 @@ void ThresholdNode::process() {
 
     // Get the image from the source node
     cv::Mat inputImage = sourceNode->getOutputImage(sourceConnector->getIndex());
+    uint64_t inputHash = sourceNode->getOutputHash(sourceConnector->getIndex());
+
+    // The grayscale image and its histogram only change with the input, so a
+    // slider move is a single table pass. A zero hash means the content is unknown.
+    if (inputHash == 0 || inputHash != grayscaleKey_ || grayscale_.empty()) {
+        // Convert to grayscale if needed
+        if (inputImage.channels() > 1) {
+            cv::cvtColor(inputImage, grayscale_, cv::COLOR_BGR2GRAY);
+        } else {
+            grayscale_ = inputImage;
+        }
+        grayscaleKey_ = inputHash;
 
-    // Calculate histogram for the input image
-    calculateHistogram(inputImage);
+        // Calculate histogram for the input image
+        calculateHistogram(grayscale_);
+    }
 
     // Update histogram plot if it exists
     if (histogramPlot_) {
@@ -47,10 +89,16 @@ void ThresholdNode::process() {
     }
 
     // Process the image
-    cv::Mat outputImage = applyThreshold(inputImage);
+    int outputChannels = singleChannelOutput_ || inputImage.channels() == 1 ? 1 : 3;
+    bool binary = thresholdType_ == ThresholdType::Binary || thresholdType_ == ThresholdType::BinaryInverted ||
+                  thresholdType_ == ThresholdType::Adaptive || thresholdType_ == ThresholdType::Otsu;
 
-    // Set output image
-    setOutputImage(outputImage, 0);
+    // One-channel binary results are passed on packed, one bit per pixel
+    if (binary && outputChannels == 1 && !grayscale_.empty() && grayscale_.type() == CV_8UC1) {
+        setOutputMask(applyThresholdMask(grayscale_), 0);
+    } else {
+        setOutputImage(applyThreshold(grayscale_, outputChannels), 0);
+    }
 
     // Mark as processed
     dirty_ = false;
@@ -74,6 +122,9 @@ QWidget* ThresholdNode::createPropertiesWidget() {
         thresholdTypeComboBox_->addItem("Otsu", static_cast<int>(ThresholdType::Otsu));
         thresholdTypeComboBox_->setCurrentIndex(static_cast<int>(thresholdType_));
         typeLayout->addWidget(thresholdTypeComboBox_);
+        singleChannelCheckBox_ = new QCheckBox("Single-channel output");
+        singleChannelCheckBox_->setChecked(singleChannelOutput_);
+        typeLayout->addWidget(singleChannelCheckBox_);
 
         // Threshold value control
         QGroupBox* thresholdGroup = new QGroupBox("Threshold Value");
@@ -91,7 +142,7 @@ QWidget* ThresholdNode::createPropertiesWidget() {
 
         adaptiveLayout->addWidget(new QLabel("Block Size:"), 0, 0);
         adaptiveBlockSizeSlider_ = new QSlider(Qt::Horizontal);
-        adaptiveBlockSizeSlider_->setRange(3, 51);
+        adaptiveBlockSizeSlider_->setRange(3, maxAdaptiveBlockSize(adaptiveMethod_));
         adaptiveBlockSizeSlider_->setSingleStep(2);
         adaptiveBlockSizeSlider_->setValue(adaptiveBlockSize_);
         adaptiveBlockSizeLabel_ = new QLabel(QString::number(adaptiveBlockSize_));
@@ -106,6 +157,13 @@ QWidget* ThresholdNode::createPropertiesWidget() {
         adaptiveLayout->addWidget(adaptiveConstantSlider_, 1, 1);
         adaptiveLayout->addWidget(adaptiveConstantLabel_, 1, 2);
 
+        adaptiveLayout->addWidget(new QLabel("Method:"), 2, 0);
+        adaptiveMethodComboBox_ = new QComboBox();
+        adaptiveMethodComboBox_->addItem("Gaussian", static_cast<int>(AdaptiveMethod::Gaussian));
+        adaptiveMethodComboBox_->addItem("Mean (integral image)", static_cast<int>(AdaptiveMethod::Mean));
+        adaptiveMethodComboBox_->setCurrentIndex(static_cast<int>(adaptiveMethod_));
+        adaptiveLayout->addWidget(adaptiveMethodComboBox_, 2, 1, 1, 2);
+
         // Histogram plot
         QGroupBox* histogramGroup = new QGroupBox("Histogram");
         QVBoxLayout* histogramLayout = new QVBoxLayout(histogramGroup);
@@ -146,6 +204,11 @@ QWidget* ThresholdNode::createPropertiesWidget() {
             dirty_ = true;
         });
 
+        connect(singleChannelCheckBox_, &QCheckBox::toggled, [this](bool checked) {
+            singleChannelOutput_ = checked;
+            dirty_ = true;
+        });
+
         connect(adaptiveBlockSizeSlider_, &QSlider::valueChanged, [this](int value) {
             // Ensure block size is odd
             if (value % 2 == 0) {
@@ -164,6 +227,10 @@ QWidget* ThresholdNode::createPropertiesWidget() {
             adaptiveConstantLabel_->setText(QString::number(value));
             dirty_ = true;
         });
+
+        connect(adaptiveMethodComboBox_, QOverload<int>::of(&QComboBox::currentIndexChanged), [this](int index) {
+            setAdaptiveMethod(static_cast<AdaptiveMethod>(index));
+        });
     }
 
     return propertiesWidget_;
@@ -204,7 +271,7 @@ void ThresholdNode::setAdaptiveBlockSize(int size) {
         size += 1;
     }
 
-    adaptiveBlockSize_ = std::max(3, std::min(51, size));
+    adaptiveBlockSize_ = std::max(3, std::min(maxAdaptiveBlockSize(adaptiveMethod_), size));
     if (adaptiveBlockSizeSlider_) {
         adaptiveBlockSizeSlider_->setValue(adaptiveBlockSize_);
     }
@@ -223,62 +290,131 @@ void ThresholdNode::setAdaptiveConstant(int constant) {
     dirty_ = true;
 }
 
-cv::Mat ThresholdNode::applyThreshold(const cv::Mat& input) {
-    if (input.empty()) {
-        return cv::Mat();
+AdaptiveMethod ThresholdNode::getAdaptiveMethod() const {
+    return adaptiveMethod_;
+}
+
+void ThresholdNode::setAdaptiveMethod(AdaptiveMethod method) {
+    adaptiveMethod_ = method;
+    if (adaptiveMethodComboBox_) {
+        adaptiveMethodComboBox_->setCurrentIndex(static_cast<int>(method));
     }
 
-    cv::Mat grayscale;
-    cv::Mat output;
+    // Switching to Gaussian shrinks the block size range
+    adaptiveBlockSize_ = std::min(adaptiveBlockSize_, maxAdaptiveBlockSize(method));
+    if (adaptiveBlockSizeSlider_) {
+        adaptiveBlockSizeSlider_->setRange(3, maxAdaptiveBlockSize(method));
+        adaptiveBlockSizeSlider_->setValue(adaptiveBlockSize_);
+    }
+    dirty_ = true;
+}
 
-    // Convert to grayscale if needed
-    if (input.channels() > 1) {
-        cv::cvtColor(input, grayscale, cv::COLOR_BGR2GRAY);
-    } else {
-        grayscale = input.clone();
+bool ThresholdNode::isSingleChannelOutput() const {
+    return singleChannelOutput_;
+}
+
+void ThresholdNode::setSingleChannelOutput(bool singleChannel) {
+    singleChannelOutput_ = singleChannel;
+    if (singleChannelCheckBox_) {
+        singleChannelCheckBox_->setChecked(singleChannel);
+    }
+    dirty_ = true;
+}
+
+std::vector<NodeParameter> ThresholdNode::getParameters() const {
+    return {
+        {"threshold", static_cast<double>(threshold_), ""},
+        {"thresholdType", static_cast<double>(thresholdType_), ""},
+        {"adaptiveBlockSize", static_cast<double>(adaptiveBlockSize_), ""},
+        {"adaptiveConstant", static_cast<double>(adaptiveConstant_), ""},
+        {"adaptiveMethod", static_cast<double>(adaptiveMethod_), ""},
+        {"singleChannelOutput", singleChannelOutput_ ? 1.0 : 0.0, ""}
+    };
+}
+
+void ThresholdNode::setParameters(const std::vector<NodeParameter>& parameters) {
+    // The method bounds the block size, so it is applied first
+    for (const NodeParameter& parameter : parameters) {
+        if (parameter.name == "adaptiveMethod") {
+            setAdaptiveMethod(static_cast<AdaptiveMethod>(static_cast<int>(parameter.value)));
+        }
     }
 
-    // Apply threshold based on selected type
+    for (const NodeParameter& parameter : parameters) {
+        if (parameter.name == "threshold") {
+            setThreshold(static_cast<int>(parameter.value));
+        } else if (parameter.name == "thresholdType") {
+            setThresholdType(static_cast<ThresholdType>(static_cast<int>(parameter.value)));
+        } else if (parameter.name == "adaptiveBlockSize") {
+            setAdaptiveBlockSize(static_cast<int>(parameter.value));
+        } else if (parameter.name == "adaptiveConstant") {
+            setAdaptiveConstant(static_cast<int>(parameter.value));
+        } else if (parameter.name == "singleChannelOutput") {
+            setSingleChannelOutput(parameter.value != 0.0);
+        }
+    }
+}
+
+cv::Mat ThresholdNode::applyThreshold(const cv::Mat& grayscale, int outputChannels) {
+    if (grayscale.empty()) {
+        return cv::Mat();
+    }
+
+    // Every type but Adaptive is a function of the gray value alone
+    int type = -1;
+    int threshold = threshold_;
     switch (thresholdType_) {
         case ThresholdType::Binary:
-            cv::threshold(grayscale, output, threshold_, 255, cv::THRESH_BINARY);
+            type = cv::THRESH_BINARY;
             break;
 
         case ThresholdType::BinaryInverted:
-            cv::threshold(grayscale, output, threshold_, 255, cv::THRESH_BINARY_INV);
+            type = cv::THRESH_BINARY_INV;
             break;
 
         case ThresholdType::Truncated:
-            cv::threshold(grayscale, output, threshold_, 255, cv::THRESH_TRUNC);
+            type = cv::THRESH_TRUNC;
             break;
 
         case ThresholdType::ToZero:
-            cv::threshold(grayscale, output, threshold_, 255, cv::THRESH_TOZERO);
+            type = cv::THRESH_TOZERO;
             break;
 
         case ThresholdType::ToZeroInverted:
-            cv::threshold(grayscale, output, threshold_, 255, cv::THRESH_TOZERO_INV);
+            type = cv::THRESH_TOZERO_INV;
             break;
 
-        case ThresholdType::Adaptive: {
-            cv::adaptiveThreshold(grayscale, output, 255, cv::ADAPTIVE_THRESH_GAUSSIAN_C,
-                                 cv::THRESH_BINARY, adaptiveBlockSize_, adaptiveConstant_);
+        case ThresholdType::Adaptive:
             break;
-        }
 
-        case ThresholdType::Otsu: {
-            cv::threshold(grayscale, output, 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
-            // Update threshold slider with Otsu's value
-            if (thresholdSlider_) {
-                int otsuThreshold = cv::threshold(grayscale, cv::Mat(), 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU);
-                thresholdSlider_->setValue(otsuThreshold);
-            }
+        case ThresholdType::Otsu:
+            type = cv::THRESH_BINARY;
+            threshold = otsuThreshold(grayscale);
             break;
-        }
+    }
+
+    // 8-bit images go through a 256-entry table, expanded to color in the same pass
+    cv::Mat output;
+    if (type >= 0 && grayscale.depth() == CV_8U) {
+        uint8_t table[256];
+        ThresholdFilters::thresholdTable(type, threshold, table);
+        ThresholdFilters::applyTable(grayscale, output, table, outputChannels);
+        return output;
+    }
+
+    if (type >= 0) {
+        cv::threshold(grayscale, output, threshold, 255, type);
+    } else if (adaptiveMethod_ == AdaptiveMethod::Mean && grayscale.type() == CV_8UC1) {
+        ThresholdFilters::adaptiveMeanThreshold(grayscale, output, adaptiveBlockSize_, adaptiveConstant_);
+    } else {
+        int method = adaptiveMethod_ == AdaptiveMethod::Mean ? cv::ADAPTIVE_THRESH_MEAN_C
+                                                             : cv::ADAPTIVE_THRESH_GAUSSIAN_C;
+        cv::adaptiveThreshold(grayscale, output, 255, method,
+                             cv::THRESH_BINARY, adaptiveBlockSize_, adaptiveConstant_);
     }
 
     // If input was color, convert output back to color
-    if (input.channels() > 1) {
+    if (outputChannels == 3) {
         cv::Mat colorOutput;
         cv::cvtColor(output, colorOutput, cv::COLOR_GRAY2BGR);
         return colorOutput;
@@ -287,27 +423,55 @@ cv::Mat ThresholdNode::applyThreshold(const cv::Mat& input) {
     return output;
 }
 
-void ThresholdNode::calculateHistogram(const cv::Mat& input) {
-    // Reset histogram
-    std::fill(histogram_.begin(), histogram_.end(), 0);
-    histogramMax_ = 0;
+BitMask ThresholdNode::applyThresholdMask(const cv::Mat& grayscale) {
+    switch (thresholdType_) {
+        case ThresholdType::Binary:
+            return BitMask::fromImage(grayscale, threshold_);
+
+        case ThresholdType::BinaryInverted: {
+            BitMask mask = BitMask::fromImage(grayscale, threshold_);
+            mask.invert();
+            return mask;
+        }
+
+        case ThresholdType::Adaptive:
+            return BitMask::fromImage(applyThreshold(grayscale, 1));
+
+        case ThresholdType::Otsu:
+            return BitMask::fromImage(grayscale, otsuThreshold(grayscale));
+
+        default:
+            return BitMask();
+    }
+}
 
-    // Convert to grayscale if needed
-    cv::Mat grayscale;
-    if (input.channels() > 1) {
-        cv::cvtColor(input, grayscale, cv::COLOR_BGR2GRAY);
+int ThresholdNode::otsuThreshold(const cv::Mat& grayscale) {
+    // Otsu's value comes from the histogram already taken for the plot
+    int threshold;
+    if (grayscale.depth() == CV_8U) {
+        threshold = ThresholdFilters::otsuThreshold(histogram_.data());
     } else {
-        grayscale = input;
+        threshold = static_cast<int>(cv::threshold(grayscale, cv::Mat(), 0, 255, cv::THRESH_BINARY | cv::THRESH_OTSU));
     }
 
-    // Calculate histogram
-    for (int y = 0; y < grayscale.rows; y++) {
-        for (int x = 0; x < grayscale.cols; x++) {
-            int intensity = grayscale.at<uchar>(y, x);
-            histogram_[intensity]++;
-            histogramMax_ = std::max(histogramMax_, histogram_[intensity]);
-        }
+    // Update threshold slider with Otsu's value
+    if (thresholdSlider_) {
+        thresholdSlider_->setValue(threshold);
+    }
+    return threshold;
+}
+
+void ThresholdNode::calculateHistogram(const cv::Mat& grayscale) {
+    // Only 8-bit images have 256 bins, others show an empty histogram
+    if (grayscale.empty() || grayscale.depth() != CV_8U) {
+        histogram_.assign(256, 0);
+        histogramMax_ = 0;
+        return;
     }
+
+    // Calculate histogram, then its peak over the 256 bins
+    ThresholdFilters::histogram(grayscale, histogram_);
+    histogramMax_ = *std::max_element(histogram_.begin(), histogram_.end());
 }
 
 void ThresholdNode::updateHistogramPlot() {
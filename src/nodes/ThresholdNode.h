@@ -8,6 +8,7 @@
 #include <QHBoxLayout>
 #include <QComboBox>
 #include <QGroupBox>
+#include <QCheckBox>
 #include <QCustomPlot>
 
 enum class ThresholdType {
@@ -20,6 +21,11 @@ enum class ThresholdType {
     Otsu
 };
 
+enum class AdaptiveMethod {
+    Gaussian,
+    Mean
+};
+
 class ThresholdNode : public Node {
 public:
     ThresholdNode();
@@ -28,6 +34,8 @@ public:
     // Node interface implementation
     void process() override;
     QWidget* createPropertiesWidget() override;
+    std::vector<NodeParameter> getParameters() const override;
+    void setParameters(const std::vector<NodeParameter>& parameters) override;
 
     // Getters and setters
     int getThreshold() const;
@@ -42,17 +50,29 @@ public:
     int getAdaptiveConstant() const;
     void setAdaptiveConstant(int constant);
 
+    AdaptiveMethod getAdaptiveMethod() const;
+    void setAdaptiveMethod(AdaptiveMethod method);
+
+    bool isSingleChannelOutput() const;
+    void setSingleChannelOutput(bool singleChannel);
+
 private:
     // Processing parameters
     int threshold_;
     ThresholdType thresholdType_;
     int adaptiveBlockSize_;
     int adaptiveConstant_;
+    AdaptiveMethod adaptiveMethod_;
+    bool singleChannelOutput_; // Skip the BGR expansion of color inputs
 
     // Histogram data
     std::vector<int> histogram_;
     int histogramMax_;
 
+    // Grayscale input, keyed by the input hash
+    cv::Mat grayscale_;
+    uint64_t grayscaleKey_;
+
     // UI components
     QWidget* propertiesWidget_;
     QSlider* thresholdSlider_;
@@ -63,11 +83,15 @@ private:
     QLabel* adaptiveBlockSizeLabel_;
     QSlider* adaptiveConstantSlider_;
     QLabel* adaptiveConstantLabel_;
+    QComboBox* adaptiveMethodComboBox_;
+    QCheckBox* singleChannelCheckBox_;
     QGroupBox* adaptiveGroup_;
 
     // Helper methods
-    cv::Mat applyThreshold(const cv::Mat& input);
-    void calculateHistogram(const cv::Mat& input);
+    cv::Mat applyThreshold(const cv::Mat& grayscale, int outputChannels);
+    BitMask applyThresholdMask(const cv::Mat& grayscale);
+    int otsuThreshold(const cv::Mat& grayscale);
+    void calculateHistogram(const cv::Mat& grayscale);
     void updateHistogramPlot();
     void updateAdaptiveControls();
 };
@@ -0,0 +1,267 @@
+#include "BitMask.h"
+#include "ImageUtils.h"
+#include "ParallelUtils.h"
+#include <algorithm>
+#include <bitset>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BITMASK_SSE2 1
+#endif
+
+namespace {
+
+// Bits of word that belong to a row of cols pixels, for the row's last word
+inline uint64_t lastWordMask(int cols) {
+    int used = cols & 63;
+    return used == 0 ? ~0ULL : (1ULL << used) - 1;
+}
+
+// 64 pixels above threshold as one word, threshold in [0, 254]
+inline uint64_t packWord(const uint8_t* src, int threshold) {
+#ifdef BITMASK_SSE2
+    // Unsigned compare as a signed one with both sides offset by 128
+    const __m128i offset = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i limit = _mm_set1_epi8(static_cast<char>(threshold ^ 0x80));
+    uint64_t word = 0;
+    for (int i = 0; i < 4; i++) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * i));
+        __m128i above = _mm_cmpgt_epi8(_mm_xor_si128(pixels, offset), limit);
+        word |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(above))) << (16 * i);
+    }
+    return word;
+#else
+    uint64_t word = 0;
+    for (int i = 0; i < 64; i++) {
+        word |= static_cast<uint64_t>(src[i] > threshold) << i;
+    }
+    return word;
+#endif
+}
+
+// Spread 64 bits to 0/255 bytes
+inline void expandWord(uint64_t word, uint8_t* dst) {
+#ifdef BITMASK_SSE2
+    // Each byte tests its own bit of a broadcast byte of the word
+    const __m128i select = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    for (int i = 0; i < 4; i++) {
+        __m128i low = _mm_set1_epi8(static_cast<char>(word >> (16 * i)));
+        __m128i high = _mm_set1_epi8(static_cast<char>(word >> (16 * i + 8)));
+        __m128i bits = _mm_and_si128(_mm_unpacklo_epi64(low, high), select);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16 * i), _mm_cmpeq_epi8(bits, select));
+    }
+#else
+    for (int i = 0; i < 64; i++) {
+        dst[i] = static_cast<uint8_t>(-static_cast<int>((word >> i) & 1));
+    }
+#endif
+}
+
+enum class BitOp {
+    And,
+    Or,
+    Xor
+};
+
+template <BitOp Op>
+inline uint64_t combineWord(uint64_t a, uint64_t b) {
+    switch (Op) {
+        case BitOp::And: return a & b;
+        case BitOp::Or:  return a | b;
+        case BitOp::Xor: return a ^ b;
+    }
+    return a;
+}
+
+#ifdef BITMASK_SSE2
+template <BitOp Op>
+inline __m128i combineVector(__m128i a, __m128i b) {
+    switch (Op) {
+        case BitOp::And: return _mm_and_si128(a, b);
+        case BitOp::Or:  return _mm_or_si128(a, b);
+        case BitOp::Xor: return _mm_xor_si128(a, b);
+    }
+    return a;
+}
+#endif
+
+// dst op= src over count words
+template <BitOp Op>
+void combineWords(uint64_t* dst, const uint64_t* src, size_t count) {
+    size_t i = 0;
+#ifdef BITMASK_SSE2
+    for (; i + 2 <= count; i += 2) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), combineVector<Op>(a, b));
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = combineWord<Op>(dst[i], src[i]);
+    }
+}
+
+} // namespace
+
+BitMask::BitMask()
+    : rows_(0), cols_(0), wordsPerRow_(0) {
+}
+
+BitMask::BitMask(int rows, int cols)
+    : rows_(std::max(0, rows)), cols_(std::max(0, cols)), wordsPerRow_((std::max(0, cols) + 63) / 64),
+      bits_(static_cast<size_t>(rows_) * wordsPerRow_, 0) {
+}
+
+BitMask BitMask::fromImage(const cv::Mat& image, int threshold) {
+    if (image.empty()) {
+        return BitMask();
+    }
+    CV_Assert(image.type() == CV_8UC1);
+
+    BitMask mask(image.rows, image.cols);
+    if (threshold >= 255) {
+        return mask;
+    }
+    if (threshold < 0) {
+        for (int y = 0; y < mask.rows_; y++) {
+            mask.setRange(y, 0, mask.cols_);
+        }
+        return mask;
+    }
+
+    int fullWords = image.cols / 64;
+    ParallelUtils::parallelFor(image.rows, ParallelUtils::stripeRows(image.cols), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            const uint8_t* src = image.ptr(y);
+            uint64_t* dst = mask.row(y);
+            for (int w = 0; w < fullWords; w++) {
+                dst[w] = packWord(src + 64 * w, threshold);
+            }
+            if (fullWords < mask.wordsPerRow_) {
+                uint64_t word = 0;
+                for (int x = 64 * fullWords; x < image.cols; x++) {
+                    word |= static_cast<uint64_t>(src[x] > threshold) << (x & 63);
+                }
+                dst[fullWords] = word;
+            }
+        }
+    });
+
+    return mask;
+}
+
+cv::Mat BitMask::toImage(int channels) const {
+    if (empty()) {
+        return cv::Mat();
+    }
+
+    cv::Mat image(rows_, cols_, CV_MAKETYPE(CV_8U, channels));
+    ParallelUtils::parallelFor(rows_, ParallelUtils::stripeRows(static_cast<size_t>(cols_) * channels), [&](int begin, int end) {
+        std::vector<uint8_t> line(channels == 1 ? 0 : cols_);
+        for (int y = begin; y < end; y++) {
+            uint8_t* dst = image.ptr(y);
+            if (channels == 1) {
+                expandRow(y, dst);
+                continue;
+            }
+
+            // Every channel holds the same value
+            expandRow(y, line.data());
+            for (int x = 0; x < cols_; x++) {
+                for (int c = 0; c < channels; c++) {
+                    dst[x * channels + c] = line[x];
+                }
+            }
+        }
+    });
+
+    return image;
+}
+
+void BitMask::expandRow(int y, uint8_t* dst) const {
+    const uint64_t* src = row(y);
+    int fullWords = cols_ / 64;
+    for (int w = 0; w < fullWords; w++) {
+        expandWord(src[w], dst + 64 * w);
+    }
+    for (int x = 64 * fullWords; x < cols_; x++) {
+        dst[x] = static_cast<uint8_t>(-static_cast<int>((src[x >> 6] >> (x & 63)) & 1));
+    }
+}
+
+void BitMask::setRange(int y, int begin, int end) {
+    begin = std::max(0, begin);
+    end = std::min(cols_, end);
+    if (begin >= end) {
+        return;
+    }
+
+    uint64_t* words = row(y);
+    int first = begin >> 6;
+    int last = (end - 1) >> 6;
+    uint64_t firstMask = ~0ULL << (begin & 63);
+    uint64_t lastMask = ~0ULL >> (63 - ((end - 1) & 63));
+    if (first == last) {
+        words[first] |= firstMask & lastMask;
+        return;
+    }
+    words[first] |= firstMask;
+    std::fill(words + first + 1, words + last, ~0ULL);
+    words[last] |= lastMask;
+}
+
+BitMask& BitMask::operator&=(const BitMask& other) {
+    CV_Assert(size() == other.size());
+    combineWords<BitOp::And>(bits_.data(), other.bits_.data(), bits_.size());
+    return *this;
+}
+
+BitMask& BitMask::operator|=(const BitMask& other) {
+    CV_Assert(size() == other.size());
+    combineWords<BitOp::Or>(bits_.data(), other.bits_.data(), bits_.size());
+    return *this;
+}
+
+BitMask& BitMask::operator^=(const BitMask& other) {
+    CV_Assert(size() == other.size());
+    combineWords<BitOp::Xor>(bits_.data(), other.bits_.data(), bits_.size());
+    return *this;
+}
+
+void BitMask::invert() {
+    size_t i = 0;
+#ifdef BITMASK_SSE2
+    const __m128i ones = _mm_set1_epi32(-1);
+    for (; i + 2 <= bits_.size(); i += 2) {
+        __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bits_.data() + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bits_.data() + i), _mm_xor_si128(words, ones));
+    }
+#endif
+    for (; i < bits_.size(); i++) {
+        bits_[i] = ~bits_[i];
+    }
+    clearPadding();
+}
+
+size_t BitMask::count() const {
+    size_t total = 0;
+    for (uint64_t word : bits_) {
+        total += std::bitset<64>(word).count();
+    }
+    return total;
+}
+
+uint64_t BitMask::hash() const {
+    uint64_t hash = ImageUtils::combineHash(static_cast<uint64_t>(rows_), static_cast<uint64_t>(cols_));
+    return ImageUtils::hashBytes(bits_.data(), bits_.size() * sizeof(uint64_t), hash);
+}
+
+void BitMask::clearPadding() {
+    if (wordsPerRow_ == 0) {
+        return;
+    }
+    uint64_t keep = lastWordMask(cols_);
+    for (int y = 0; y < rows_; y++) {
+        row(y)[wordsPerRow_ - 1] &= keep;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+// Binary image packed one bit per pixel, for the 0/255 results of thresholds
+// and edge detectors. Each row starts on a 64-bit word, pixel x is bit x % 64
+// of word x / 64 and the bits past the last column are always clear.
+class BitMask {
+public:
+    BitMask();
+    BitMask(int rows, int cols);
+
+    // Pack a one-channel 8-bit image, a bit is set where the pixel is above threshold
+    static BitMask fromImage(const cv::Mat& image, int threshold = 0);
+
+    // Expand to an 8-bit image holding 0 or 255 in each of its channels
+    cv::Mat toImage(int channels = 1) const;
+
+    // Expand one row to 0/255 bytes, cols() of them
+    void expandRow(int y, uint8_t* dst) const;
+
+    bool empty() const { return rows_ == 0 || cols_ == 0; }
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+    cv::Size size() const { return cv::Size(cols_, rows_); }
+    int wordsPerRow() const { return wordsPerRow_; }
+
+    uint64_t* row(int y) { return bits_.data() + static_cast<size_t>(y) * wordsPerRow_; }
+    const uint64_t* row(int y) const { return bits_.data() + static_cast<size_t>(y) * wordsPerRow_; }
+
+    bool get(int y, int x) const { return (row(y)[x >> 6] >> (x & 63)) & 1; }
+
+    // Set pixels [begin, end) of row y
+    void setRange(int y, int begin, int end);
+
+    // Bitwise operations with a mask of the same size, a vector at a time
+    BitMask& operator&=(const BitMask& other);
+    BitMask& operator|=(const BitMask& other);
+    BitMask& operator^=(const BitMask& other);
+    void invert();
+
+    // Number of set pixels
+    size_t count() const;
+
+    // Hash of the size and bits
+    uint64_t hash() const;
+
+private:
+    int rows_;
+    int cols_;
+    int wordsPerRow_;
+    std::vector<uint64_t> bits_;
+
+    void clearPadding();
+};
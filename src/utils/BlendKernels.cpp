@@ -0,0 +1,459 @@
+#include "BlendKernels.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#define BLENDKERNELS_SSE2 1
+#if defined(__GNUC__) || defined(__clang__)
+#define BLENDKERNELS_AVX2 1
+#define BLENDKERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(_MSC_VER)
+#include <intrin.h>
+#define BLENDKERNELS_AVX2 1
+#define BLENDKERNELS_TARGET_AVX2
+#endif
+#endif
+
+namespace {
+
+// All paths use the same integer math on 16-bit intermediates:
+//   x / 255 rounded       (t + (t >> 8)) >> 8 with t = x + 128, exact for x <= 65025
+//   opacity               (blend * w + bg * (256 - w) + 128) >> 8 with w = opacity * 256 / 100
+// Overlay doubles only the operand pair that keeps the product below 65025.
+
+inline int divide255(int value) {
+    int t = value + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+inline int opacityWeight(int opacity) {
+    return (std::max(0, std::min(100, opacity)) * 256 + 50) / 100;
+}
+
+template <BlendMode Mode>
+inline int blendScalar(int f, int b) {
+    switch (Mode) {
+        case BlendMode::Normal:     return f;
+        case BlendMode::Multiply:   return divide255(f * b);
+        case BlendMode::Screen:     return 255 - divide255((255 - f) * (255 - b));
+        case BlendMode::Overlay:
+            return b < 128 ? divide255(2 * f * b) : 255 - divide255(2 * (255 - f) * (255 - b));
+        case BlendMode::Difference: return std::abs(f - b);
+        case BlendMode::Addition:   return std::min(f + b, 255);
+        case BlendMode::Subtract:   return std::max(b - f, 0);
+        case BlendMode::Darken:     return std::min(f, b);
+        case BlendMode::Lighten:    return std::max(f, b);
+    }
+    return f;
+}
+
+template <BlendMode Mode>
+void blendRange(const uint8_t* fg, const uint8_t* bg, uint8_t* dst, size_t begin, size_t end,
+                int weight, bool keepAlpha) {
+    for (size_t i = begin; i < end; i++) {
+        if (keepAlpha && (i & 3) == 3) {
+            dst[i] = bg[i];
+            continue;
+        }
+        int blended = blendScalar<Mode>(fg[i], bg[i]);
+        dst[i] = static_cast<uint8_t>((blended * weight + bg[i] * (256 - weight) + 128) >> 8);
+    }
+}
+
+template <BlendMode Mode>
+void blendRowScalar(const uint8_t* fg, const uint8_t* bg, uint8_t* dst, size_t count, int weight, bool keepAlpha) {
+    blendRange<Mode>(fg, bg, dst, 0, count, weight, keepAlpha);
+}
+
+void lerpWeightedRange(const uint8_t* top, const uint8_t* bottom, const uint16_t* weights, uint8_t* dst,
+                       size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        dst[i] = static_cast<uint8_t>((top[i] * weights[i] + bottom[i] * (256 - weights[i]) + 128) >> 8);
+    }
+}
+
+#ifndef BLENDKERNELS_SSE2
+void lerpWeightedScalar(const uint8_t* top, const uint8_t* bottom, const uint16_t* weights, uint8_t* dst, size_t count) {
+    lerpWeightedRange(top, bottom, weights, dst, 0, count);
+}
+#endif
+
+#ifdef BLENDKERNELS_SSE2
+
+inline __m128i divide255(__m128i value) {
+    __m128i t = _mm_add_epi16(value, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+// Blend eight 16-bit lanes holding values 0-255
+template <BlendMode Mode>
+inline __m128i blendSse2(__m128i f, __m128i b) {
+    const __m128i full = _mm_set1_epi16(255);
+    switch (Mode) {
+        case BlendMode::Normal:     return f;
+        case BlendMode::Multiply:   return divide255(_mm_mullo_epi16(f, b));
+        case BlendMode::Screen:
+            return _mm_sub_epi16(full, divide255(_mm_mullo_epi16(_mm_sub_epi16(full, f), _mm_sub_epi16(full, b))));
+        case BlendMode::Overlay: {
+            // Both halves are computed, products of the unused half may wrap
+            __m128i dark = _mm_cmplt_epi16(b, _mm_set1_epi16(128));
+            __m128i multiplied = divide255(_mm_slli_epi16(_mm_mullo_epi16(f, b), 1));
+            __m128i screened = _mm_sub_epi16(full, divide255(_mm_slli_epi16(
+                _mm_mullo_epi16(_mm_sub_epi16(full, f), _mm_sub_epi16(full, b)), 1)));
+            return _mm_or_si128(_mm_and_si128(dark, multiplied), _mm_andnot_si128(dark, screened));
+        }
+        case BlendMode::Difference: return _mm_sub_epi16(_mm_max_epi16(f, b), _mm_min_epi16(f, b));
+        case BlendMode::Addition:   return _mm_min_epi16(_mm_add_epi16(f, b), full);
+        case BlendMode::Subtract:   return _mm_max_epi16(_mm_sub_epi16(b, f), _mm_setzero_si128());
+        case BlendMode::Darken:     return _mm_min_epi16(f, b);
+        case BlendMode::Lighten:    return _mm_max_epi16(f, b);
+    }
+    return f;
+}
+
+template <BlendMode Mode>
+inline __m128i blendOpacitySse2(__m128i f, __m128i b, __m128i weight, __m128i inverseWeight) {
+    __m128i blended = blendSse2<Mode>(f, b);
+    __m128i sum = _mm_add_epi16(_mm_mullo_epi16(blended, weight), _mm_mullo_epi16(b, inverseWeight));
+    return _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(128)), 8);
+}
+
+template <BlendMode Mode>
+void blendRowSse2(const uint8_t* fg, const uint8_t* bg, uint8_t* dst, size_t count, int weight, bool keepAlpha) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i weights = _mm_set1_epi16(static_cast<short>(weight));
+    const __m128i inverseWeights = _mm_set1_epi16(static_cast<short>(256 - weight));
+    const __m128i alphaMask = keepAlpha ? _mm_set1_epi32(static_cast<int>(0xFF000000)) : zero;
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(fg + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bg + i));
+
+        __m128i low = blendOpacitySse2<Mode>(_mm_unpacklo_epi8(f, zero), _mm_unpacklo_epi8(b, zero), weights, inverseWeights);
+        __m128i high = blendOpacitySse2<Mode>(_mm_unpackhi_epi8(f, zero), _mm_unpackhi_epi8(b, zero), weights, inverseWeights);
+        __m128i result = _mm_packus_epi16(low, high);
+
+        // Keep the background alpha bytes
+        result = _mm_or_si128(_mm_andnot_si128(alphaMask, result), _mm_and_si128(alphaMask, b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), result);
+    }
+
+    blendRange<Mode>(fg, bg, dst, i, count, weight, keepAlpha);
+}
+
+void lerpWeightedSse2(const uint8_t* top, const uint8_t* bottom, const uint16_t* weights, uint8_t* dst, size_t count) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(256);
+    const __m128i half = _mm_set1_epi16(128);
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(top + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + i));
+        __m128i weightLow = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i));
+        __m128i weightHigh = _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i + 8));
+
+        __m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(t, zero), weightLow),
+                                    _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), _mm_sub_epi16(full, weightLow)));
+        __m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(t, zero), weightHigh),
+                                     _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), _mm_sub_epi16(full, weightHigh)));
+        low = _mm_srli_epi16(_mm_add_epi16(low, half), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, half), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(low, high));
+    }
+
+    lerpWeightedRange(top, bottom, weights, dst, i, count);
+}
+
+#endif
+
+#ifdef BLENDKERNELS_AVX2
+
+BLENDKERNELS_TARGET_AVX2 inline __m256i divide255(__m256i value) {
+    __m256i t = _mm256_add_epi16(value, _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+// Blend sixteen 16-bit lanes holding values 0-255
+template <BlendMode Mode>
+BLENDKERNELS_TARGET_AVX2 inline __m256i blendAvx2(__m256i f, __m256i b) {
+    const __m256i full = _mm256_set1_epi16(255);
+    switch (Mode) {
+        case BlendMode::Normal:     return f;
+        case BlendMode::Multiply:   return divide255(_mm256_mullo_epi16(f, b));
+        case BlendMode::Screen:
+            return _mm256_sub_epi16(full, divide255(_mm256_mullo_epi16(_mm256_sub_epi16(full, f), _mm256_sub_epi16(full, b))));
+        case BlendMode::Overlay: {
+            // Both halves are computed, products of the unused half may wrap
+            __m256i dark = _mm256_cmpgt_epi16(_mm256_set1_epi16(128), b);
+            __m256i multiplied = divide255(_mm256_slli_epi16(_mm256_mullo_epi16(f, b), 1));
+            __m256i screened = _mm256_sub_epi16(full, divide255(_mm256_slli_epi16(
+                _mm256_mullo_epi16(_mm256_sub_epi16(full, f), _mm256_sub_epi16(full, b)), 1)));
+            return _mm256_blendv_epi8(screened, multiplied, dark);
+        }
+        case BlendMode::Difference: return _mm256_sub_epi16(_mm256_max_epu16(f, b), _mm256_min_epu16(f, b));
+        case BlendMode::Addition:   return _mm256_min_epu16(_mm256_add_epi16(f, b), full);
+        case BlendMode::Subtract:   return _mm256_subs_epu16(b, f);
+        case BlendMode::Darken:     return _mm256_min_epu16(f, b);
+        case BlendMode::Lighten:    return _mm256_max_epu16(f, b);
+    }
+    return f;
+}
+
+template <BlendMode Mode>
+BLENDKERNELS_TARGET_AVX2 inline __m256i blendOpacityAvx2(__m256i f, __m256i b, __m256i weight, __m256i inverseWeight) {
+    __m256i blended = blendAvx2<Mode>(f, b);
+    __m256i sum = _mm256_add_epi16(_mm256_mullo_epi16(blended, weight), _mm256_mullo_epi16(b, inverseWeight));
+    return _mm256_srli_epi16(_mm256_add_epi16(sum, _mm256_set1_epi16(128)), 8);
+}
+
+template <BlendMode Mode>
+BLENDKERNELS_TARGET_AVX2 void blendRowAvx2(const uint8_t* fg, const uint8_t* bg, uint8_t* dst, size_t count,
+                                           int weight, bool keepAlpha) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i weights = _mm256_set1_epi16(static_cast<short>(weight));
+    const __m256i inverseWeights = _mm256_set1_epi16(static_cast<short>(256 - weight));
+    const __m256i alphaMask = keepAlpha ? _mm256_set1_epi32(static_cast<int>(0xFF000000)) : zero;
+
+    // Unpacking and packing both work within 128-bit lanes, so byte order is preserved
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(fg + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bg + i));
+
+        __m256i low = blendOpacityAvx2<Mode>(_mm256_unpacklo_epi8(f, zero), _mm256_unpacklo_epi8(b, zero), weights, inverseWeights);
+        __m256i high = blendOpacityAvx2<Mode>(_mm256_unpackhi_epi8(f, zero), _mm256_unpackhi_epi8(b, zero), weights, inverseWeights);
+        __m256i result = _mm256_packus_epi16(low, high);
+
+        // Keep the background alpha bytes
+        result = _mm256_blendv_epi8(result, b, alphaMask);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), result);
+    }
+
+    blendRowSse2<Mode>(fg + i, bg + i, dst + i, count - i, weight, keepAlpha);
+}
+
+BLENDKERNELS_TARGET_AVX2 void lerpWeightedAvx2(const uint8_t* top, const uint8_t* bottom, const uint16_t* weights,
+                                               uint8_t* dst, size_t count) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i full = _mm256_set1_epi16(256);
+    const __m256i half = _mm256_set1_epi16(128);
+
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i t = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(top + i));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bottom + i));
+
+        // Weights of bytes 0-7 and 16-23 pair with the low unpack, 8-15 and 24-31 with the high one
+        __m256i weightsA = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i));
+        __m256i weightsB = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i + 16));
+        __m256i weightLow = _mm256_permute2x128_si256(weightsA, weightsB, 0x20);
+        __m256i weightHigh = _mm256_permute2x128_si256(weightsA, weightsB, 0x31);
+
+        __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(t, zero), weightLow),
+                                       _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), _mm256_sub_epi16(full, weightLow)));
+        __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(t, zero), weightHigh),
+                                        _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), _mm256_sub_epi16(full, weightHigh)));
+        low = _mm256_srli_epi16(_mm256_add_epi16(low, half), 8);
+        high = _mm256_srli_epi16(_mm256_add_epi16(high, half), 8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_packus_epi16(low, high));
+    }
+
+    lerpWeightedSse2(top + i, bottom + i, weights + i, dst + i, count - i);
+}
+
+#endif
+
+using RowFunction = void (*)(const uint8_t*, const uint8_t*, uint8_t*, size_t, int, bool);
+using WeightedFunction = void (*)(const uint8_t*, const uint8_t*, const uint16_t*, uint8_t*, size_t);
+
+// Kernels of one instruction set, blend rows indexed by BlendMode
+struct KernelTable {
+    const char* name;
+    RowFunction rows[9];
+    WeightedFunction weighted;
+};
+
+template <template <BlendMode> class Kernel>
+KernelTable makeTable(const char* name, WeightedFunction weighted) {
+    return {name, {
+        Kernel<BlendMode::Normal>::run, Kernel<BlendMode::Multiply>::run, Kernel<BlendMode::Screen>::run,
+        Kernel<BlendMode::Overlay>::run, Kernel<BlendMode::Difference>::run, Kernel<BlendMode::Addition>::run,
+        Kernel<BlendMode::Subtract>::run, Kernel<BlendMode::Darken>::run, Kernel<BlendMode::Lighten>::run
+    }, weighted};
+}
+
+template <BlendMode Mode>
+struct ScalarKernel {
+    static constexpr RowFunction run = blendRowScalar<Mode>;
+};
+
+#ifdef BLENDKERNELS_SSE2
+template <BlendMode Mode>
+struct Sse2Kernel {
+    static constexpr RowFunction run = blendRowSse2<Mode>;
+};
+#endif
+
+#ifdef BLENDKERNELS_AVX2
+template <BlendMode Mode>
+struct Avx2Kernel {
+    static constexpr RowFunction run = blendRowAvx2<Mode>;
+};
+#endif
+
+#ifdef BLENDKERNELS_AVX2
+bool cpuSupportsAvx2() {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, 0, 0);
+    if (info[0] < 7) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+#else
+    return false;
+#endif
+}
+#endif
+
+const KernelTable& selectKernels() {
+    // Chosen once, the CPU does not change while the application runs
+    static const KernelTable table = []() {
+#ifdef BLENDKERNELS_AVX2
+        if (cpuSupportsAvx2()) {
+            return makeTable<Avx2Kernel>("AVX2", lerpWeightedAvx2);
+        }
+#endif
+#ifdef BLENDKERNELS_SSE2
+        return makeTable<Sse2Kernel>("SSE2", lerpWeightedSse2);
+#else
+        return makeTable<ScalarKernel>("Scalar", lerpWeightedScalar);
+#endif
+    }();
+    return table;
+}
+
+} // namespace
+
+namespace BlendKernels {
+
+void blendRow(BlendMode mode, const uint8_t* fg, const uint8_t* bg, uint8_t* dst,
+              size_t count, int opacity, bool keepAlpha) {
+    int index = static_cast<int>(mode);
+    if (index < 0 || index >= 9) {
+        index = static_cast<int>(BlendMode::Normal);
+    }
+    selectKernels().rows[index](fg, bg, dst, count, opacityWeight(opacity), keepAlpha);
+}
+
+void lerpRow(const uint8_t* top, const uint8_t* bg, uint8_t* dst, size_t count, int opacity, bool keepAlpha) {
+    blendRow(BlendMode::Normal, top, bg, dst, count, opacity, keepAlpha);
+}
+
+void lerpRowWeighted(const uint8_t* top, const uint8_t* bottom, const uint16_t* weights, uint8_t* dst, size_t count) {
+    selectKernels().weighted(top, bottom, weights, dst, count);
+}
+
+void compositeRow(const uint8_t* blended, const uint8_t* fg, const uint8_t* bg, const uint8_t* coverage,
+                  uint8_t* dst, int width, int channels, int opacity, bool premultiplied) {
+    // Per-row scratch, reused by each worker thread
+    thread_local std::vector<uint16_t> weights;
+    thread_local std::vector<uint8_t> mixed;
+    size_t count = static_cast<size_t>(width) * channels;
+    weights.resize(count);
+
+    int opacityScale = opacityWeight(opacity);
+
+    if (channels != 4) {
+        // Coverage only scales the opacity of each pixel
+        for (int x = 0; x < width; x++) {
+            uint16_t weight = static_cast<uint16_t>(coverage ? (opacityScale * coverage[x] + 127) / 255 : opacityScale);
+            for (int c = 0; c < channels; c++) {
+                weights[x * channels + c] = weight;
+            }
+        }
+        lerpRowWeighted(blended, bg, weights.data(), dst, count);
+        return;
+    }
+
+    // W3C compositing with straight alpha in 8.8 fixed point:
+    //   mixed  = lerp(fg, B(fg, bg), bg alpha)
+    //   alpha  = source alpha + bg alpha * (1 - source alpha)
+    //   color  = lerp(bg, mixed, source alpha / alpha)
+    // where the source alpha is fg alpha scaled by opacity and coverage
+    mixed.resize(count);
+    for (int x = 0; x < width; x++) {
+        int backgroundAlpha = bg[x * 4 + 3];
+        uint16_t mixWeight = static_cast<uint16_t>(backgroundAlpha + (backgroundAlpha >> 7));
+        for (int c = 0; c < 4; c++) {
+            weights[x * 4 + c] = mixWeight;
+        }
+    }
+    lerpRowWeighted(blended, fg, weights.data(), mixed.data(), count);
+
+    for (int x = 0; x < width; x++) {
+        // Source alpha is kept unrounded in units of 1 / (256 * 255)
+        int scale = coverage ? (opacityScale * coverage[x] + 127) / 255 : opacityScale;
+        int sourceAlpha = scale * fg[x * 4 + 3];
+        int64_t coverageSum = static_cast<int64_t>(sourceAlpha) * 255 + bg[x * 4 + 3] * (65280 - sourceAlpha);
+        int alpha = static_cast<int>((coverageSum + 32640) / 65280);
+        uint16_t colorWeight = static_cast<uint16_t>(coverageSum > 0
+            ? (static_cast<int64_t>(sourceAlpha) * 255 * 256 + coverageSum / 2) / coverageSum : 0);
+        for (int c = 0; c < 4; c++) {
+            weights[x * 4 + c] = colorWeight;
+        }
+        mixed[x * 4 + 3] = static_cast<uint8_t>(alpha);
+    }
+    lerpRowWeighted(mixed.data(), bg, weights.data(), dst, count);
+
+    // The alpha bytes above were lerped with themselves, restore the composite alpha
+    for (int x = 0; x < width; x++) {
+        dst[x * 4 + 3] = mixed[x * 4 + 3];
+    }
+
+    if (premultiplied) {
+        premultiplyRow(dst, dst, width);
+    }
+}
+
+void premultiplyRow(const uint8_t* src, uint8_t* dst, int width) {
+    for (int x = 0; x < width; x++) {
+        int alpha = src[x * 4 + 3];
+        for (int c = 0; c < 3; c++) {
+            dst[x * 4 + c] = static_cast<uint8_t>(divide255(src[x * 4 + c] * alpha));
+        }
+        dst[x * 4 + 3] = static_cast<uint8_t>(alpha);
+    }
+}
+
+void unpremultiplyRow(const uint8_t* src, uint8_t* dst, int width) {
+    // Reciprocals of each alpha value in 16.16 fixed point
+    static const std::array<uint32_t, 256> reciprocals = []() {
+        std::array<uint32_t, 256> table = {};
+        for (int alpha = 1; alpha < 256; alpha++) {
+            table[alpha] = static_cast<uint32_t>((255u * 65536u + alpha / 2) / alpha);
+        }
+        return table;
+    }();
+
+    for (int x = 0; x < width; x++) {
+        int alpha = src[x * 4 + 3];
+        for (int c = 0; c < 3; c++) {
+            uint32_t value = (src[x * 4 + c] * reciprocals[alpha] + 32768) >> 16;
+            dst[x * 4 + c] = static_cast<uint8_t>(std::min<uint32_t>(value, 255));
+        }
+        dst[x * 4 + 3] = static_cast<uint8_t>(alpha);
+    }
+}
+
+const char* getInstructionSet() {
+    return selectKernels().name;
+}
+
+} // namespace BlendKernels
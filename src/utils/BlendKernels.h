@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class BlendMode {
+    Normal,
+    Multiply,
+    Screen,
+    Overlay,
+    Difference,
+    Addition,
+    Subtract,
+    Darken,
+    Lighten
+};
+
+// Fixed-point blend kernels for 8-bit images
+//
+// Channels are blended independently, so rows of 1, 3 and 4-channel images are
+// passed as flat byte ranges. The SSE2 and AVX2 paths are selected at runtime
+// and produce exactly the same bytes as the scalar fallback.
+namespace BlendKernels {
+
+// Blend count bytes of fg over bg into dst at opacity 0-100. With keepAlpha the
+// data is BGRA and every fourth byte is copied from bg. dst may be bg, which
+// lets a stack of layers be blended in place.
+void blendRow(BlendMode mode, const uint8_t* fg, const uint8_t* bg, uint8_t* dst,
+              size_t count, int opacity, bool keepAlpha);
+
+// Mix count bytes of top over bg at opacity 0-100. Equal to blendRow in Normal
+// mode, so a stored full-opacity blend result can be faded without redoing it.
+void lerpRow(const uint8_t* top, const uint8_t* bg, uint8_t* dst, size_t count, int opacity, bool keepAlpha);
+
+// Mix count bytes of top over bottom with a weight of 0-256 per byte
+void lerpRowWeighted(const uint8_t* top, const uint8_t* bottom, const uint16_t* weights, uint8_t* dst, size_t count);
+
+// Composite one row of a full-opacity blend result over bg in a single pass.
+// Opacity is scaled per pixel by coverage (a one-channel mask, or nullptr).
+// 4-channel rows are composited with the fg and bg alpha (W3C source-over);
+// with premultiplied set the output is premultiplied, the inputs are straight.
+void compositeRow(const uint8_t* blended, const uint8_t* fg, const uint8_t* bg, const uint8_t* coverage,
+                  uint8_t* dst, int width, int channels, int opacity, bool premultiplied);
+
+// Convert BGRA rows between straight and premultiplied alpha, src may be dst
+void premultiplyRow(const uint8_t* src, uint8_t* dst, int width);
+void unpremultiplyRow(const uint8_t* src, uint8_t* dst, int width);
+
+// Instruction set used by blendRow on this machine
+const char* getInstructionSet();
+
+} // namespace BlendKernels
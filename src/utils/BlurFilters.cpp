@@ -0,0 +1,613 @@
+#include "BlurFilters.h"
+#include "ParallelUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <vector>
+
+namespace {
+
+// Third-order recursive filter coefficients, normalized by b0
+struct RecursiveCoefficients {
+    float gain;
+    float a1;
+    float a2;
+    float a3;
+};
+
+RecursiveCoefficients youngVanVliet(double sigma) {
+    double q = sigma >= 2.5 ? 0.98711 * sigma - 0.96330 : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+    double q2 = q * q;
+    double q3 = q2 * q;
+    double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    double b1 = 2.44413 * q + 2.85619 * q2 + 1.26661 * q3;
+    double b2 = -(1.4281 * q2 + 1.26661 * q3);
+    double b3 = 0.422205 * q3;
+
+    RecursiveCoefficients c;
+    c.a1 = static_cast<float>(b1 / b0);
+    c.a2 = static_cast<float>(b2 / b0);
+    c.a3 = static_cast<float>(b3 / b0);
+    c.gain = 1.0f - (c.a1 + c.a2 + c.a3);
+    return c;
+}
+
+// Causal and anti-causal passes along a strided line, edges are extended with their values
+void filterLine(float* data, int length, int stride, const RecursiveCoefficients& c) {
+    float w1 = data[0];
+    float w2 = w1;
+    float w3 = w1;
+    for (int i = 0; i < length; i++) {
+        float w = c.gain * data[i * stride] + c.a1 * w1 + c.a2 * w2 + c.a3 * w3;
+        data[i * stride] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+
+    w1 = data[(length - 1) * stride];
+    w2 = w1;
+    w3 = w1;
+    for (int i = length - 1; i >= 0; i--) {
+        float w = c.gain * data[i * stride] + c.a1 * w1 + c.a2 * w2 + c.a3 * w3;
+        data[i * stride] = w;
+        w3 = w2;
+        w2 = w1;
+        w1 = w;
+    }
+}
+
+// Spread samples at distance t * (ux, uy) over the four surrounding pixels
+std::vector<BlurFilters::KernelTap> splatLine(const std::vector<float>& profile, int firstOffset, float ux, float uy) {
+    std::vector<BlurFilters::KernelTap> taps;
+    auto addTap = [&taps](int dx, int dy, float weight) {
+        if (weight <= 0.0f) return;
+        for (BlurFilters::KernelTap& tap : taps) {
+            if (tap.dx == dx && tap.dy == dy) {
+                tap.weight += weight;
+                return;
+            }
+        }
+        taps.push_back({dx, dy, weight});
+    };
+
+    for (size_t i = 0; i < profile.size(); i++) {
+        float t = static_cast<float>(firstOffset + static_cast<int>(i));
+        float x = t * ux;
+        float y = t * uy;
+        int x0 = static_cast<int>(std::floor(x));
+        int y0 = static_cast<int>(std::floor(y));
+        float fx = x - x0;
+        float fy = y - y0;
+        addTap(x0, y0, profile[i] * (1.0f - fx) * (1.0f - fy));
+        addTap(x0 + 1, y0, profile[i] * fx * (1.0f - fy));
+        addTap(x0, y0 + 1, profile[i] * (1.0f - fx) * fy);
+        addTap(x0 + 1, y0 + 1, profile[i] * fx * fy);
+    }
+    return taps;
+}
+
+// Weighted sum of shifted rows of a padded float image
+void applyTaps(const cv::Mat& padded, cv::Mat& output, const std::vector<BlurFilters::KernelTap>& taps, int pad) {
+    int channels = output.channels();
+    int lineWidth = output.cols * channels;
+    ParallelUtils::parallelFor(output.rows, ParallelUtils::stripeRows(output.cols * output.elemSize()), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            float* dst = output.ptr<float>(y);
+            std::fill(dst, dst + lineWidth, 0.0f);
+            for (const BlurFilters::KernelTap& tap : taps) {
+                const float* src = padded.ptr<float>(y + pad + tap.dy) + (pad + tap.dx) * channels;
+                for (int i = 0; i < lineWidth; i++) {
+                    dst[i] += tap.weight * src[i];
+                }
+            }
+        }
+    });
+}
+
+// Two-level histogram: 16 coarse bins of the high nibble, 256 fine bins
+struct ColumnHistograms {
+    std::vector<uint16_t> coarse; // 16 per column
+    std::vector<uint16_t> fine;   // 256 per column
+};
+
+// Median filter rows [begin, end) of one channel of a padded 8-bit image
+void medianStripe(const cv::Mat& padded, cv::Mat& output, int channel, int radius, int begin, int end,
+                  ColumnHistograms& columns) {
+    int channels = padded.channels();
+    int paddedWidth = padded.cols;
+    int window = 2 * radius + 1;
+    uint32_t target = static_cast<uint32_t>(window) * window / 2;
+
+    std::fill(columns.coarse.begin(), columns.coarse.end(), 0);
+    std::fill(columns.fine.begin(), columns.fine.end(), 0);
+    auto addRow = [&](int row, int delta) {
+        const uint8_t* src = padded.ptr(row) + channel;
+        for (int x = 0; x < paddedWidth; x++) {
+            uint8_t value = src[x * channels];
+            columns.coarse[x * 16 + (value >> 4)] += delta;
+            columns.fine[x * 256 + value] += delta;
+        }
+    };
+
+    // Column histograms start with all but the last row of the first window
+    for (int row = begin; row < begin + window - 1; row++) {
+        addRow(row, 1);
+    }
+
+    uint32_t coarse[16];
+    uint32_t fine[16][16];
+    int fineEnd[16];
+    for (int y = begin; y < end; y++) {
+        // Slide the column histograms down one row
+        addRow(y + window - 1, 1);
+        if (y > begin) {
+            addRow(y - 1, -1);
+        }
+
+        // Coarse kernel histogram of the first window, fine bins are filled on demand
+        std::fill(coarse, coarse + 16, 0u);
+        for (int x = 0; x < window; x++) {
+            const uint16_t* column = &columns.coarse[x * 16];
+            for (int bin = 0; bin < 16; bin++) {
+                coarse[bin] += column[bin];
+            }
+        }
+        std::fill(fineEnd, fineEnd + 16, 0);
+
+        uint8_t* dst = output.ptr(y) + channel;
+        for (int x = 0; x < output.cols; x++) {
+            if (x > 0) {
+                const uint16_t* added = &columns.coarse[(x + window - 1) * 16];
+                const uint16_t* removed = &columns.coarse[(x - 1) * 16];
+                for (int bin = 0; bin < 16; bin++) {
+                    coarse[bin] += added[bin] - removed[bin];
+                }
+            }
+
+            // Coarse bin holding the median
+            uint32_t count = 0;
+            int high = 0;
+            while (count + coarse[high] <= target) {
+                count += coarse[high];
+                high++;
+            }
+
+            // Bring its fine bins up to the current window, columns [x, x + window)
+            uint32_t* fineBins = fine[high];
+            if (fineEnd[high] <= x) {
+                std::fill(fineBins, fineBins + 16, 0u);
+                for (int column = x; column < x + window; column++) {
+                    const uint16_t* bins = &columns.fine[column * 256 + high * 16];
+                    for (int bin = 0; bin < 16; bin++) {
+                        fineBins[bin] += bins[bin];
+                    }
+                }
+            } else {
+                for (int column = fineEnd[high]; column < x + window; column++) {
+                    const uint16_t* added = &columns.fine[column * 256 + high * 16];
+                    const uint16_t* removed = &columns.fine[(column - window) * 256 + high * 16];
+                    for (int bin = 0; bin < 16; bin++) {
+                        fineBins[bin] += added[bin] - removed[bin];
+                    }
+                }
+            }
+            fineEnd[high] = x + window;
+
+            int low = 0;
+            while (count + fineBins[low] <= target) {
+                count += fineBins[low];
+                low++;
+            }
+            dst[x * channels] = static_cast<uint8_t>(high * 16 + low);
+        }
+    }
+}
+
+// Smallest bilateral grid cells, a pixel-sized cell is no faster than the exact filter
+const double kMinGridSpatialSampling = 4.0;
+const double kMinGridRangeSampling = 8.0;
+
+// Largest bilateral grid in floats, 256 MB
+const size_t kMaxGridValues = size_t(1) << 26;
+
+// Homogeneous bilateral grid, per cell the channel sums followed by the weight
+struct BilateralGrid {
+    int width;
+    int height;
+    int depth;
+    int stride;
+    std::vector<float> data;
+
+    float* cell(int x, int y, int z) { return &data[((static_cast<size_t>(y) * width + x) * depth + z) * stride]; }
+    const float* cell(int x, int y, int z) const { return &data[((static_cast<size_t>(y) * width + x) * depth + z) * stride]; }
+};
+
+// Intensity used as the range coordinate, integer luma for color pixels
+inline int guideValue(const uint8_t* pixel, int channels) {
+    return channels >= 3 ? (pixel[0] * 29 + pixel[1] * 150 + pixel[2] * 77 + 128) >> 8 : pixel[0];
+}
+
+std::vector<float> gaussianTaps(double sigma) {
+    int radius = std::max(1, static_cast<int>(std::ceil(2.0 * sigma)));
+    std::vector<float> taps(2 * radius + 1);
+    for (int i = -radius; i <= radius; i++) {
+        taps[i + radius] = static_cast<float>(std::exp(-0.5 * i * i / (sigma * sigma)));
+    }
+    return taps;
+}
+
+// Blur the grid in place along one axis, cells beyond the edge hold nothing.
+// Each line of cells is copied to a buffer first, so no second grid is needed.
+void blurGridAxis(BilateralGrid& grid, int axis, const std::vector<float>& taps) {
+    int radius = static_cast<int>(taps.size()) / 2;
+    int stride = grid.stride;
+    int extent = axis == 0 ? grid.width : axis == 1 ? grid.height : grid.depth;
+    size_t step = axis == 0 ? static_cast<size_t>(grid.depth) * stride
+                : axis == 1 ? static_cast<size_t>(grid.width) * grid.depth * stride
+                : static_cast<size_t>(stride);
+
+    // Lines along x and z are split by grid row, lines along y by grid column
+    int outerCount = axis == 1 ? grid.width : grid.height;
+    int innerCount = axis == 2 ? grid.width : grid.depth;
+    ParallelUtils::parallelFor(outerCount, 1, [&](int begin, int end) {
+        std::vector<float> line(static_cast<size_t>(extent) * stride);
+        for (int outer = begin; outer < end; outer++) {
+            for (int inner = 0; inner < innerCount; inner++) {
+                float* first = axis == 0 ? grid.cell(0, outer, inner)
+                             : axis == 1 ? grid.cell(outer, 0, inner)
+                             : grid.cell(inner, outer, 0);
+                for (int position = 0; position < extent; position++) {
+                    std::copy(first + position * step, first + position * step + stride, &line[position * stride]);
+                }
+
+                for (int position = 0; position < extent; position++) {
+                    float* out = first + position * step;
+                    std::fill(out, out + stride, 0.0f);
+                    int from = std::max(-radius, -position);
+                    int to = std::min(radius, extent - 1 - position);
+                    for (int i = from; i <= to; i++) {
+                        const float* in = &line[(position + i) * stride];
+                        float weight = taps[i + radius];
+                        for (int c = 0; c < stride; c++) {
+                            out[c] += weight * in[c];
+                        }
+                    }
+                }
+            }
+        }
+    });
+}
+
+} // namespace
+
+namespace BlurFilters {
+
+double gaussianSigma(int radius) {
+    return 0.3 * (radius - 1) + 0.8;
+}
+
+void recursiveGaussian(const cv::Mat& input, cv::Mat& output, double sigma) {
+    if (input.empty()) {
+        output = cv::Mat();
+        return;
+    }
+
+    RecursiveCoefficients c = youngVanVliet(std::max(0.5, sigma));
+    int channels = input.channels();
+    int width = input.cols;
+    int height = input.rows;
+
+    cv::Mat buffer;
+    input.convertTo(buffer, CV_MAKETYPE(CV_32F, channels));
+
+    // Horizontal pass, one row per line and channel
+    ParallelUtils::parallelFor(height, ParallelUtils::stripeRows(buffer.cols * buffer.elemSize()), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            float* row = buffer.ptr<float>(y);
+            for (int ch = 0; ch < channels; ch++) {
+                filterLine(row + ch, width, channels, c);
+            }
+        }
+    });
+
+    // Vertical pass, run across whole rows so memory is read sequentially
+    int lineWidth = width * channels;
+    const int kColumnBlock = 256;
+    int blocks = (lineWidth + kColumnBlock - 1) / kColumnBlock;
+    ParallelUtils::parallelFor(blocks, 1, [&](int begin, int end) {
+        int x0 = begin * kColumnBlock;
+        int x1 = std::min(lineWidth, end * kColumnBlock);
+        int count = x1 - x0;
+        std::vector<float> w1(buffer.ptr<float>(0) + x0, buffer.ptr<float>(0) + x1);
+        std::vector<float> w2 = w1;
+        std::vector<float> w3 = w1;
+
+        for (int y = 0; y < height; y++) {
+            float* row = buffer.ptr<float>(y) + x0;
+            for (int x = 0; x < count; x++) {
+                float w = c.gain * row[x] + c.a1 * w1[x] + c.a2 * w2[x] + c.a3 * w3[x];
+                row[x] = w;
+                w3[x] = w2[x];
+                w2[x] = w1[x];
+                w1[x] = w;
+            }
+        }
+
+        const float* last = buffer.ptr<float>(height - 1) + x0;
+        w1.assign(last, last + count);
+        w2 = w1;
+        w3 = w1;
+        for (int y = height - 1; y >= 0; y--) {
+            float* row = buffer.ptr<float>(y) + x0;
+            for (int x = 0; x < count; x++) {
+                float w = c.gain * row[x] + c.a1 * w1[x] + c.a2 * w2[x] + c.a3 * w3[x];
+                row[x] = w;
+                w3[x] = w2[x];
+                w2[x] = w1[x];
+                w1[x] = w;
+            }
+        }
+    });
+
+    buffer.convertTo(output, input.type());
+}
+
+DirectionalKernel makeDirectionalKernel(int radius, int xDirection, int yDirection) {
+    DirectionalKernel kernel;
+    kernel.radius = radius;
+    kernel.xDirection = xDirection;
+    kernel.yDirection = yDirection;
+
+    cv::Mat gaussian = cv::getGaussianKernel(2 * radius + 1, gaussianSigma(radius), CV_32F);
+    float length = std::sqrt(static_cast<float>(xDirection * xDirection + yDirection * yDirection));
+    float ux = length > 0.0f ? xDirection / length : 1.0f;
+    float uy = length > 0.0f ? yDirection / length : 0.0f;
+
+    // The dense kernel weights each pixel by its Gaussian and by how far it lies
+    // along the direction. The Gaussian is isotropic, so in the rotated frame
+    // this is a ramp-weighted Gaussian along the direction times a Gaussian across
+    // it. Without a direction both lines are the symmetric Gaussian.
+    int alongStart = length > 0.0f ? 0 : -radius;
+    float alongSum = 0.0f;
+    for (int t = alongStart; t <= radius; t++) {
+        float weight = gaussian.at<float>(radius + t) * (length > 0.0f ? t : 1.0f);
+        kernel.alongProfile.push_back(weight);
+        alongSum += weight;
+    }
+    for (float& weight : kernel.alongProfile) {
+        weight /= alongSum;
+    }
+    for (int t = -radius; t <= radius; t++) {
+        kernel.acrossProfile.push_back(gaussian.at<float>(radius + t));
+    }
+
+    kernel.alongTaps = splatLine(kernel.alongProfile, alongStart, ux, uy);
+    kernel.acrossTaps = splatLine(kernel.acrossProfile, -radius, -uy, ux);
+    return kernel;
+}
+
+void directionalBlur(const cv::Mat& input, cv::Mat& output, const DirectionalKernel& kernel) {
+    if (input.empty()) {
+        output = cv::Mat();
+        return;
+    }
+
+    // Taps reach at most radius + 1 pixels in any direction
+    int pad = kernel.radius + 1;
+    cv::Mat buffer;
+    input.convertTo(buffer, CV_MAKETYPE(CV_32F, input.channels()));
+
+    cv::Mat padded;
+    cv::Mat blurred(buffer.size(), buffer.type());
+    cv::copyMakeBorder(buffer, padded, pad, pad, pad, pad, cv::BORDER_REPLICATE);
+    applyTaps(padded, blurred, kernel.alongTaps, pad);
+
+    cv::copyMakeBorder(blurred, padded, pad, pad, pad, pad, cv::BORDER_REPLICATE);
+    applyTaps(padded, blurred, kernel.acrossTaps, pad);
+
+    blurred.convertTo(output, input.type());
+}
+
+void medianBlur(const cv::Mat& input, cv::Mat& output, int radius) {
+    if (input.empty()) {
+        output = cv::Mat();
+        return;
+    }
+    CV_Assert(input.depth() == CV_8U);
+
+    cv::Mat padded;
+    cv::copyMakeBorder(input, padded, radius, radius, radius, radius, cv::BORDER_REPLICATE);
+    cv::Mat result(input.size(), input.type());
+
+    // Every stripe first fills its column histograms with a whole window of
+    // rows, so stripes are kept several windows tall to amortize that
+    int window = 2 * radius + 1;
+    int grain = std::max(4 * window, ParallelUtils::stripeRows(input.cols * input.elemSize()));
+    ParallelUtils::parallelFor(input.rows, grain, [&](int begin, int end) {
+        ColumnHistograms columns;
+        columns.coarse.resize(padded.cols * 16);
+        columns.fine.resize(padded.cols * 256);
+        for (int channel = 0; channel < input.channels(); channel++) {
+            medianStripe(padded, result, channel, radius, begin, end, columns);
+        }
+    });
+
+    output = result;
+}
+
+bool bilateralGrid(const cv::Mat& input, cv::Mat& output, double sigmaSpace, double sigmaRange,
+                   double spatialSampling, double rangeSampling) {
+    if (input.empty()) {
+        output = cv::Mat();
+        return true;
+    }
+    CV_Assert(input.depth() == CV_8U);
+
+    int channels = input.channels();
+    spatialSampling = std::max(kMinGridSpatialSampling, spatialSampling);
+    rangeSampling = std::max(kMinGridRangeSampling, rangeSampling);
+
+    // Grid blur in cell units, padded so neither the blur nor the slice leaves the grid
+    std::vector<float> spatialTaps = gaussianTaps(sigmaSpace / spatialSampling);
+    std::vector<float> rangeTaps = gaussianTaps(sigmaRange / rangeSampling);
+    int spatialPad = static_cast<int>(spatialTaps.size()) / 2 + 1;
+    int rangePad = static_cast<int>(rangeTaps.size()) / 2 + 1;
+
+    BilateralGrid grid;
+    grid.width = static_cast<int>((input.cols - 1) / spatialSampling) + 2 + 2 * spatialPad;
+    grid.height = static_cast<int>((input.rows - 1) / spatialSampling) + 2 + 2 * spatialPad;
+    grid.depth = static_cast<int>(255 / rangeSampling) + 2 + 2 * rangePad;
+    grid.stride = channels + 1;
+    size_t gridValues = static_cast<size_t>(grid.width) * grid.height * grid.depth * grid.stride;
+    if (gridValues > kMaxGridValues) {
+        return false;
+    }
+    try {
+        grid.data.assign(gridValues, 0.0f);
+    } catch (const std::bad_alloc&) {
+        return false;
+    }
+
+    // Splat each pixel into its nearest cell. Image rows are grouped by the
+    // grid row they land in, so stripes of grid rows never share a cell.
+    std::vector<std::vector<int>> rowsOfGridRow(grid.height);
+    for (int y = 0; y < input.rows; y++) {
+        rowsOfGridRow[static_cast<int>(y / spatialSampling + 0.5) + spatialPad].push_back(y);
+    }
+    ParallelUtils::parallelFor(grid.height, 1, [&](int begin, int end) {
+        for (int gridY = begin; gridY < end; gridY++) {
+            for (int y : rowsOfGridRow[gridY]) {
+                const uint8_t* src = input.ptr(y);
+                for (int x = 0; x < input.cols; x++) {
+                    const uint8_t* pixel = src + x * channels;
+                    int gridX = static_cast<int>(x / spatialSampling + 0.5) + spatialPad;
+                    int gridZ = static_cast<int>(guideValue(pixel, channels) / rangeSampling + 0.5) + rangePad;
+                    float* cell = grid.cell(gridX, gridY, gridZ);
+                    for (int c = 0; c < channels; c++) {
+                        cell[c] += pixel[c];
+                    }
+                    cell[channels] += 1.0f;
+                }
+            }
+        }
+    });
+
+    // Separable Gaussian over the three grid axes
+    blurGridAxis(grid, 0, spatialTaps);
+    blurGridAxis(grid, 1, spatialTaps);
+    blurGridAxis(grid, 2, rangeTaps);
+
+    // Slice, normalizing the trilinearly interpolated sums by their weight
+    cv::Mat result(input.size(), input.type());
+    ParallelUtils::parallelFor(input.rows, ParallelUtils::stripeRows(input.cols * input.elemSize()), [&](int begin, int end) {
+        std::vector<float> sum(grid.stride);
+        for (int y = begin; y < end; y++) {
+            const uint8_t* src = input.ptr(y);
+            uint8_t* dst = result.ptr(y);
+            float gy = static_cast<float>(y / spatialSampling) + spatialPad;
+            int y0 = static_cast<int>(gy);
+            float fy = gy - y0;
+            for (int x = 0; x < input.cols; x++) {
+                const uint8_t* pixel = src + x * channels;
+                float gx = static_cast<float>(x / spatialSampling) + spatialPad;
+                float gz = static_cast<float>(guideValue(pixel, channels) / rangeSampling) + rangePad;
+                int x0 = static_cast<int>(gx);
+                int z0 = static_cast<int>(gz);
+                float fx = gx - x0;
+                float fz = gz - z0;
+
+                std::fill(sum.begin(), sum.end(), 0.0f);
+                for (int corner = 0; corner < 8; corner++) {
+                    int dx = corner & 1;
+                    int dy = (corner >> 1) & 1;
+                    int dz = corner >> 2;
+                    float weight = (dx ? fx : 1.0f - fx) * (dy ? fy : 1.0f - fy) * (dz ? fz : 1.0f - fz);
+                    const float* cell = grid.cell(x0 + dx, y0 + dy, z0 + dz);
+                    for (int c = 0; c <= channels; c++) {
+                        sum[c] += weight * cell[c];
+                    }
+                }
+
+                for (int c = 0; c < channels; c++) {
+                    dst[x * channels + c] = sum[channels] > 0.0f ? cv::saturate_cast<uint8_t>(sum[c] / sum[channels]) : pixel[c];
+                }
+            }
+        }
+    });
+
+    output = result;
+    return true;
+}
+
+cv::Mat integralImage(const cv::Mat& input) {
+    CV_Assert(input.depth() == CV_8U);
+
+    int channels = input.channels();
+    int lineWidth = (input.cols + 1) * channels;
+    cv::Mat integral(input.rows + 1, input.cols + 1, CV_MAKETYPE(CV_32S, channels));
+    std::fill(integral.ptr<uint32_t>(0), integral.ptr<uint32_t>(0) + lineWidth, 0u);
+
+    // Running sums along each row
+    ParallelUtils::parallelFor(input.rows, ParallelUtils::stripeRows(lineWidth * sizeof(uint32_t)), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            const uint8_t* src = input.ptr(y);
+            uint32_t* dst = integral.ptr<uint32_t>(y + 1);
+            for (int c = 0; c < channels; c++) {
+                dst[c] = 0;
+            }
+            for (int i = 0; i < input.cols * channels; i++) {
+                dst[i + channels] = dst[i] + src[i];
+            }
+        }
+    });
+
+    // Then down the columns, a block of whole rows at a time
+    const int kColumnBlock = 1024;
+    int blocks = (lineWidth + kColumnBlock - 1) / kColumnBlock;
+    ParallelUtils::parallelFor(blocks, 1, [&](int begin, int end) {
+        int x0 = begin * kColumnBlock;
+        int x1 = std::min(lineWidth, end * kColumnBlock);
+        for (int y = 1; y <= input.rows; y++) {
+            const uint32_t* above = integral.ptr<uint32_t>(y - 1);
+            uint32_t* row = integral.ptr<uint32_t>(y);
+            for (int x = x0; x < x1; x++) {
+                row[x] += above[x];
+            }
+        }
+    });
+
+    return integral;
+}
+
+void boxBlur(const cv::Mat& integral, cv::Mat& output, int radius) {
+    int channels = integral.channels();
+    int width = integral.cols - 1;
+    int height = integral.rows - 1;
+    cv::Mat result(height, width, CV_MAKETYPE(CV_8U, channels));
+
+    ParallelUtils::parallelFor(height, ParallelUtils::stripeRows(width * channels), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            int top = std::max(0, y - radius);
+            int bottom = std::min(height, y + radius + 1);
+            const uint32_t* topRow = integral.ptr<uint32_t>(top);
+            const uint32_t* bottomRow = integral.ptr<uint32_t>(bottom);
+            uint8_t* dst = result.ptr(y);
+
+            for (int x = 0; x < width; x++) {
+                int left = std::max(0, x - radius);
+                int right = std::min(width, x + radius + 1);
+                uint32_t area = static_cast<uint32_t>((bottom - top) * (right - left));
+                for (int c = 0; c < channels; c++) {
+                    uint32_t sum = bottomRow[right * channels + c] - bottomRow[left * channels + c] -
+                                   topRow[right * channels + c] + topRow[left * channels + c];
+                    dst[x * channels + c] = static_cast<uint8_t>((sum + area / 2) / area);
+                }
+            }
+        }
+    });
+
+    output = result;
+}
+
+} // namespace BlurFilters
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace BlurFilters {
+
+// One weighted sample at an integer pixel offset
+struct KernelTap {
+    int dx;
+    int dy;
+    float weight;
+};
+
+// Directional Gaussian factored into two line filters in the rotated frame:
+// a one-sided ramp-weighted Gaussian along the direction, then a plain
+// Gaussian across it. Sub-pixel line positions are split bilinearly over
+// whole-pixel taps, so each pass is O(radius) per pixel.
+struct DirectionalKernel {
+    int radius = 0;
+    int xDirection = 0;
+    int yDirection = 0;
+    std::vector<float> alongProfile;  // weights at distance 0..radius, -radius..radius without a direction
+    std::vector<float> acrossProfile; // weights at distance -radius..radius
+    std::vector<KernelTap> alongTaps;
+    std::vector<KernelTap> acrossTaps;
+};
+
+// Gaussian sigma OpenCV derives for a kernel of 2 * radius + 1 taps
+double gaussianSigma(int radius);
+
+// Young-van Vliet recursive Gaussian, cost per pixel independent of sigma.
+// Accepts any depth and channel count, the result has the input's type.
+void recursiveGaussian(const cv::Mat& input, cv::Mat& output, double sigma);
+
+// Build the kernel for a blur towards (xDirection, yDirection). A zero
+// direction has no preferred side and gives a plain Gaussian.
+DirectionalKernel makeDirectionalKernel(int radius, int xDirection, int yDirection);
+
+// Apply a directional kernel, borders are replicated
+void directionalBlur(const cv::Mat& input, cv::Mat& output, const DirectionalKernel& kernel);
+
+// Summed-area table of an 8-bit image, (rows + 1) x (cols + 1) with the
+// channels of the input. Sums are kept modulo 2^32 in CV_32S, which stays
+// exact for any box whose true sum fits in 32 bits.
+cv::Mat integralImage(const cv::Mat& input);
+
+// Mean over a (2 * radius + 1)^2 box read from an integral image, O(1) per
+// pixel for any radius. Boxes are clipped at the borders and averaged over
+// the pixels they cover. The output is 8-bit with the integral's channels.
+void boxBlur(const cv::Mat& integral, cv::Mat& output, int radius);
+
+// Median over a (2 * radius + 1)^2 window of an 8-bit image with any number of
+// channels, borders replicated like cv::medianBlur. Uses sliding column
+// histograms (Perreault-Hebert), so the cost per pixel does not grow with radius.
+void medianBlur(const cv::Mat& input, cv::Mat& output, int radius);
+
+// Approximate bilateral filter of an 8-bit image on a bilateral grid (Paris and
+// Durand). Pixels are splatted into cells of spatialSampling pixels by
+// rangeSampling intensity levels, the grid is Gaussian blurred and the result
+// is read back with trilinear interpolation. Color images use their luma as
+// the range guide. Cost is close to linear in the pixel count for any sigma.
+// Cells are at least 4 pixels by 8 levels; returns false and leaves output
+// alone when the grid would still be too large to allocate.
+bool bilateralGrid(const cv::Mat& input, cv::Mat& output, double sigmaSpace, double sigmaRange,
+                   double spatialSampling, double rangeSampling);
+
+} // namespace BlurFilters
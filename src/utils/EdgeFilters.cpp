@@ -0,0 +1,442 @@
+#include "EdgeFilters.h"
+#include "ParallelUtils.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// OpenCV's binomial kernels for the 3, 5 and 7 tap Gaussian and Sobel filters
+struct SobelKernels {
+    int size;
+    int blur[7];
+    int blurShift; // blur taps sum to 1 << blurShift
+    int smooth[7];
+    int deriv[7];
+};
+
+const SobelKernels kSobelKernels[] = {
+    {3, {1, 2, 1}, 2, {1, 2, 1}, {-1, 0, 1}},
+    {5, {1, 4, 6, 4, 1}, 4, {1, 4, 6, 4, 1}, {-1, -2, 0, 2, 1}},
+    {7, {2, 7, 14, 18, 14, 7, 2}, 6, {1, 6, 15, 20, 15, 6, 1}, {-1, -4, -5, 0, 5, 4, 1}}
+};
+
+// OpenCV's default border, reflected without repeating the edge pixel
+int reflect101(int position, int length) {
+    if (length == 1) return 0;
+    while (position < 0 || position >= length) {
+        position = position < 0 ? -position : 2 * length - 2 - position;
+    }
+    return position;
+}
+
+// Fixed-point BGR to gray, the same coefficients and rounding as cv::cvtColor
+void grayRow(const uint8_t* src, uint8_t* dst, int width, int channels) {
+    if (channels == 1) {
+        std::copy(src, src + width, dst);
+        return;
+    }
+    for (int x = 0; x < width; x++) {
+        const uint8_t* pixel = src + x * channels;
+        dst[x] = static_cast<uint8_t>((pixel[0] * 1868 + pixel[1] * 9617 + pixel[2] * 4899 + (1 << 13)) >> 14);
+    }
+}
+
+// Correlate a row padded by half a kernel on each side
+template <typename Src>
+void filterRow(const Src* padded, int32_t* dst, int width, const int* taps, int size) {
+    std::fill(dst, dst + width, 0);
+    for (int i = 0; i < size; i++) {
+        int tap = taps[i];
+        if (tap == 0) continue;
+        const Src* src = padded + i;
+        for (int x = 0; x < width; x++) {
+            dst[x] += tap * src[x];
+        }
+    }
+}
+
+// Extend a row by half a kernel on each side with reflected pixels
+template <typename T>
+void padRow(const T* src, T* padded, int width, int half) {
+    std::copy(src, src + width, padded + half);
+    for (int i = 1; i <= half; i++) {
+        padded[half - i] = src[reflect101(-i, width)];
+        padded[half + width - 1 + i] = src[reflect101(width - 1 + i, width)];
+    }
+}
+
+// Lines of a filter stage kept around while the rows that need them are made,
+// line i lives in slot i % size. Windows never span more than size lines.
+class LineCache {
+public:
+    LineCache(int lines, size_t lineLength) : data_(lines * lineLength), indices_(lines, -1), lineLength_(lineLength) {}
+
+    template <typename Compute>
+    int32_t* get(int index, Compute compute) {
+        int slot = index % static_cast<int>(indices_.size());
+        int32_t* line = &data_[slot * lineLength_];
+        if (indices_[slot] != index) {
+            compute(index, line);
+            indices_[slot] = index;
+        }
+        return line;
+    }
+
+private:
+    std::vector<int32_t> data_;
+    std::vector<int> indices_;
+    size_t lineLength_;
+};
+
+// tan(22.5 degrees) in Q15, as used by cv::Canny
+const int kTan22 = 13573;
+
+// Horizontal run of Canny candidate pixels [begin, end) in one row
+struct EdgeRun {
+    int begin;
+    int end;
+    bool strong;
+};
+
+// Runs found by one stripe, rowStarts[i] indexes the first run of its i-th row
+struct StripeRuns {
+    std::vector<EdgeRun> runs;
+    std::vector<int> rowStarts;
+    int firstRun = 0; // index of runs[0] among all runs
+};
+
+int findRoot(std::vector<int>& parents, int run) {
+    while (parents[run] != run) {
+        parents[run] = parents[parents[run]];
+        run = parents[run];
+    }
+    return run;
+}
+
+void unite(std::vector<int>& parents, int a, int b) {
+    a = findRoot(parents, a);
+    b = findRoot(parents, b);
+    if (a != b) {
+        parents[std::max(a, b)] = std::min(a, b);
+    }
+}
+
+// Join the 8-connected runs of two neighbouring rows, indices are global
+void uniteRows(std::vector<int>& parents, const EdgeRun* upper, int upperCount, int upperFirst,
+               const EdgeRun* lower, int lowerCount, int lowerFirst) {
+    int i = 0;
+    int j = 0;
+    while (i < upperCount && j < lowerCount) {
+        // Diagonal neighbours touch, so runs connect when they overlap after growing by one pixel
+        if (upper[i].begin <= lower[j].end && lower[j].begin <= upper[i].end) {
+            unite(parents, upperFirst + i, lowerFirst + j);
+        }
+        if (upper[i].end < lower[j].end) {
+            i++;
+        } else {
+            j++;
+        }
+    }
+}
+
+// L1 gradient magnitude of a row, with a zero pixel on each side
+void magnitudeRow(const cv::Mat& dx, const cv::Mat& dy, int row, int* magnitude) {
+    int width = dx.cols;
+    magnitude[0] = 0;
+    magnitude[width + 1] = 0;
+    if (row < 0 || row >= dx.rows) {
+        std::fill(magnitude + 1, magnitude + width + 1, 0);
+        return;
+    }
+    const int16_t* gx = dx.ptr<int16_t>(row);
+    const int16_t* gy = dy.ptr<int16_t>(row);
+    for (int x = 0; x < width; x++) {
+        magnitude[x + 1] = std::abs(static_cast<int>(gx[x])) + std::abs(static_cast<int>(gy[x]));
+    }
+}
+
+} // namespace
+
+namespace EdgeFilters {
+
+void sobelMagnitude(const cv::Mat& input, cv::Mat& magnitude, int kernelSize) {
+    if (input.empty()) {
+        magnitude = cv::Mat();
+        return;
+    }
+    CV_Assert(input.depth() == CV_8U);
+
+    const SobelKernels& kernels = kSobelKernels[kernelSize >= 7 ? 2 : kernelSize >= 5 ? 1 : 0];
+    int size = kernels.size;
+    int half = size / 2;
+    int width = input.cols;
+    int height = input.rows;
+    int channels = input.channels();
+    cv::Mat result(height, width, CV_8UC1);
+
+    // Stripes recompute a few lines of context at their top, keep them tall enough to amortize that
+    int grain = std::max(8 * size, ParallelUtils::stripeRows(width));
+    ParallelUtils::parallelFor(height, grain, [&](int begin, int end) {
+        std::vector<uint8_t> paddedGray(width + 2 * half);
+        std::vector<uint8_t> paddedBlurred(width + 2 * half);
+        std::vector<int32_t> blurredSum(width);
+        std::vector<int32_t> gradientX(width);
+        std::vector<int32_t> gradientY(width);
+        std::vector<const int32_t*> blurWindow(size);
+        std::vector<const int32_t*> sobelWindow(size);
+
+        // Gray lines blurred along x
+        LineCache blurredX(size, width);
+        auto computeBlurredX = [&](int row, int32_t* line) {
+            grayRow(input.ptr(row), paddedGray.data() + half, width, channels);
+            padRow(paddedGray.data() + half, paddedGray.data(), width, half);
+            filterRow(paddedGray.data(), line, width, kernels.blur, size);
+        };
+
+        // Lines of the blurred image filtered along x, derivative then smoothing
+        LineCache sobelX(size, 2 * width);
+        auto computeSobelX = [&](int row, int32_t* line) {
+            for (int i = 0; i < size; i++) {
+                blurWindow[i] = blurredX.get(reflect101(row + i - half, height), computeBlurredX);
+            }
+            std::fill(blurredSum.begin(), blurredSum.end(), 0);
+            for (int i = 0; i < size; i++) {
+                int tap = kernels.blur[i];
+                const int32_t* src = blurWindow[i];
+                for (int x = 0; x < width; x++) {
+                    blurredSum[x] += tap * src[x];
+                }
+            }
+            int shift = 2 * kernels.blurShift;
+            int round = 1 << (shift - 1);
+            for (int x = 0; x < width; x++) {
+                paddedBlurred[half + x] = static_cast<uint8_t>((blurredSum[x] + round) >> shift);
+            }
+            padRow(paddedBlurred.data() + half, paddedBlurred.data(), width, half);
+            filterRow(paddedBlurred.data(), line, width, kernels.deriv, size);
+            filterRow(paddedBlurred.data(), line + width, width, kernels.smooth, size);
+        };
+
+        for (int y = begin; y < end; y++) {
+            for (int i = 0; i < size; i++) {
+                sobelWindow[i] = sobelX.get(reflect101(y + i - half, height), computeSobelX);
+            }
+
+            // Finish the separable filters along y
+            std::fill(gradientX.begin(), gradientX.end(), 0);
+            std::fill(gradientY.begin(), gradientY.end(), 0);
+            for (int i = 0; i < size; i++) {
+                int smooth = kernels.smooth[i];
+                int deriv = kernels.deriv[i];
+                const int32_t* derivX = sobelWindow[i];
+                const int32_t* smoothX = sobelWindow[i] + width;
+                for (int x = 0; x < width; x++) {
+                    gradientX[x] += smooth * derivX[x];
+                    gradientY[x] += deriv * smoothX[x];
+                }
+            }
+
+            uint8_t* dst = result.ptr(y);
+            for (int x = 0; x < width; x++) {
+                // convertScaleAbs of the CV_16S gradients, then addWeighted's half sum rounded to even
+                int ax = std::min(255, std::abs(gradientX[x]));
+                int ay = std::min(255, std::abs(gradientY[x]));
+                int sum = ax + ay;
+                dst[x] = static_cast<uint8_t>((sum >> 1) + (sum & (sum >> 1) & 1));
+            }
+        }
+    });
+
+    magnitude = result;
+}
+
+void canny(const cv::Mat& dx, const cv::Mat& dy, BitMask& edges, double lowThreshold, double highThreshold) {
+    if (dx.empty()) {
+        edges = BitMask();
+        return;
+    }
+    CV_Assert(dx.type() == CV_16SC1 && dy.type() == CV_16SC1 && dx.size() == dy.size());
+
+    if (lowThreshold > highThreshold) {
+        std::swap(lowThreshold, highThreshold);
+    }
+    int low = static_cast<int>(std::floor(lowThreshold));
+    int high = static_cast<int>(std::floor(highThreshold));
+    int width = dx.cols;
+    int height = dx.rows;
+
+    // Non-maximum suppression, each stripe keeps its candidates as runs
+    int grain = std::max(16, ParallelUtils::stripeRows(width * 2 * sizeof(int16_t)));
+    int stripeCount = (height + grain - 1) / grain;
+    std::vector<StripeRuns> stripes(stripeCount);
+    ParallelUtils::parallelFor(height, grain, [&](int begin, int end) {
+        StripeRuns& stripe = stripes[begin / grain];
+        std::vector<int> magnitudes(3 * (width + 2));
+        int* above = &magnitudes[0];
+        int* current = &magnitudes[width + 2];
+        int* below = &magnitudes[2 * (width + 2)];
+        magnitudeRow(dx, dy, begin - 1, above);
+        magnitudeRow(dx, dy, begin, current);
+
+        for (int y = begin; y < end; y++) {
+            magnitudeRow(dx, dy, y + 1, below);
+            stripe.rowStarts.push_back(static_cast<int>(stripe.runs.size()));
+
+            const int16_t* gx = dx.ptr<int16_t>(y);
+            const int16_t* gy = dy.ptr<int16_t>(y);
+            bool inRun = false;
+            for (int x = 0; x < width; x++) {
+                int m = current[x + 1];
+                bool candidate = false;
+                if (m > low) {
+                    int xs = gx[x];
+                    int ys = gy[x];
+                    int ax = std::abs(xs);
+                    int ay = std::abs(ys) << 15;
+                    int tan22x = ax * kTan22;
+                    if (ay < tan22x) {
+                        candidate = m > current[x] && m >= current[x + 2];
+                    } else {
+                        int64_t tan67x = tan22x + (static_cast<int64_t>(ax) << 16);
+                        if (ay > tan67x) {
+                            candidate = m > above[x + 1] && m >= below[x + 1];
+                        } else {
+                            int s = (xs ^ ys) < 0 ? -1 : 1;
+                            candidate = m > above[x + 1 - s] && m > below[x + 1 + s];
+                        }
+                    }
+                }
+
+                if (candidate) {
+                    if (!inRun) {
+                        stripe.runs.push_back({x, x + 1, false});
+                        inRun = true;
+                    }
+                    stripe.runs.back().end = x + 1;
+                    stripe.runs.back().strong = stripe.runs.back().strong || m > high;
+                } else {
+                    inRun = false;
+                }
+            }
+
+            std::swap(above, current);
+            std::swap(current, below);
+        }
+        stripe.rowStarts.push_back(static_cast<int>(stripe.runs.size()));
+    });
+
+    // Number the runs of all stripes
+    int runCount = 0;
+    for (StripeRuns& stripe : stripes) {
+        stripe.firstRun = runCount;
+        runCount += static_cast<int>(stripe.runs.size());
+    }
+    std::vector<int> parents(runCount);
+    for (int run = 0; run < runCount; run++) {
+        parents[run] = run;
+    }
+
+    // Connect runs of neighbouring rows inside each stripe, stripes only touch their own runs
+    ParallelUtils::parallelFor(stripeCount, 1, [&](int begin, int end) {
+        for (int index = begin; index < end; index++) {
+            const StripeRuns& stripe = stripes[index];
+            for (size_t row = 1; row + 1 < stripe.rowStarts.size(); row++) {
+                int upperStart = stripe.rowStarts[row - 1];
+                int lowerStart = stripe.rowStarts[row];
+                uniteRows(parents, stripe.runs.data() + upperStart, lowerStart - upperStart, stripe.firstRun + upperStart,
+                          stripe.runs.data() + lowerStart, stripe.rowStarts[row + 1] - lowerStart, stripe.firstRun + lowerStart);
+            }
+        }
+    });
+
+    // Then across the borders between stripes
+    for (int index = 1; index < stripeCount; index++) {
+        const StripeRuns& upper = stripes[index - 1];
+        const StripeRuns& lower = stripes[index];
+        int upperStart = upper.rowStarts[upper.rowStarts.size() - 2];
+        int upperCount = static_cast<int>(upper.runs.size()) - upperStart;
+        int lowerCount = lower.rowStarts[1];
+        if (upperCount > 0 && lowerCount > 0) {
+            uniteRows(parents, upper.runs.data() + upperStart, upperCount, upper.firstRun + upperStart,
+                      lower.runs.data(), lowerCount, lower.firstRun);
+        }
+    }
+
+    // Hysteresis, a component is an edge if any of its runs holds a strong pixel
+    std::vector<uint8_t> strongRoots(runCount, 0);
+    for (const StripeRuns& stripe : stripes) {
+        for (size_t run = 0; run < stripe.runs.size(); run++) {
+            if (stripe.runs[run].strong) {
+                strongRoots[findRoot(parents, stripe.firstRun + static_cast<int>(run))] = 1;
+            }
+        }
+    }
+    for (int run = 0; run < runCount; run++) {
+        parents[run] = findRoot(parents, run);
+    }
+
+    // Stripes own whole rows of the mask, so they set their runs without sharing words
+    BitMask result(height, width);
+    ParallelUtils::parallelFor(height, grain, [&](int begin, int end) {
+        const StripeRuns& stripe = stripes[begin / grain];
+        for (int y = begin; y < end; y++) {
+            int row = y - begin;
+            for (int run = stripe.rowStarts[row]; run < stripe.rowStarts[row + 1]; run++) {
+                if (strongRoots[parents[stripe.firstRun + run]]) {
+                    result.setRange(y, stripe.runs[run].begin, stripe.runs[run].end);
+                }
+            }
+        }
+    });
+
+    edges = result;
+}
+
+void overlayEdges(const cv::Mat& image, const BitMask& edges, cv::Mat& output, const cv::Scalar& color) {
+    if (image.empty() || edges.empty()) {
+        output = cv::Mat();
+        return;
+    }
+    CV_Assert(image.depth() == CV_8U && edges.size() == image.size());
+
+    int channels = image.channels();
+    int lineWidth = image.cols * channels;
+    cv::Mat result(image.size(), image.type());
+
+    // One row of the overlay color, so the blend below is a flat byte loop
+    std::vector<uint8_t> colorRow(lineWidth);
+    for (int i = 0; i < lineWidth; i++) {
+        colorRow[i] = cv::saturate_cast<uint8_t>(color[i % channels]);
+    }
+
+    ParallelUtils::parallelFor(image.rows, ParallelUtils::stripeRows(lineWidth), [&](int begin, int end) {
+        std::vector<uint8_t> mask(lineWidth);
+        std::vector<uint8_t> edge(channels == 1 ? 0 : image.cols);
+        for (int y = begin; y < end; y++) {
+            const uint8_t* src = image.ptr(y);
+            uint8_t* dst = result.ptr(y);
+
+            // Spread each edge bit over the pixel's channels as an all-ones byte mask
+            if (channels == 1) {
+                edges.expandRow(y, mask.data());
+            } else {
+                edges.expandRow(y, edge.data());
+                for (int x = 0; x < image.cols; x++) {
+                    for (int c = 0; c < channels; c++) {
+                        mask[x * channels + c] = edge[x];
+                    }
+                }
+            }
+
+            // Masked write, selecting bits without branches
+            for (int i = 0; i < lineWidth; i++) {
+                dst[i] = src[i] ^ ((src[i] ^ colorRow[i]) & mask[i]);
+            }
+        }
+    });
+
+    output = result;
+}
+
+} // namespace EdgeFilters
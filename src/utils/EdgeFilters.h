@@ -0,0 +1,29 @@
+#pragma once
+
+#include "BitMask.h"
+#include <opencv2/opencv.hpp>
+
+namespace EdgeFilters {
+
+// Sobel gradient magnitude of an 8-bit image in one pass: grayscale, Gaussian
+// pre-blur and Sobel of kernelSize (3, 5 or 7), then the mean of |dx| and
+// |dy|. Rows are streamed through small line buffers in parallel stripes. The
+// result matches cvtColor, GaussianBlur, Sobel (CV_16S), convertScaleAbs and
+// addWeighted run one after another.
+void sobelMagnitude(const cv::Mat& input, cv::Mat& magnitude, int kernelSize);
+
+// Canny edges from CV_16S x and y gradients, the same edges as
+// cv::Canny(dx, dy, edges, low, high) with the L1 norm. Gradients of a 7x7
+// Sobel must be scaled by 1/16 and the thresholds with them, as cv::Canny
+// does for its own aperture 7. Non-maximum suppression
+// runs in parallel row stripes and records candidate pixels as runs. The
+// hysteresis joins 8-connected runs with a union-find, first inside each
+// stripe and then across stripe borders, and keeps components with a strong
+// pixel. The kept runs are written straight into the packed mask.
+void canny(const cv::Mat& dx, const cv::Mat& dy, BitMask& edges, double lowThreshold, double highThreshold);
+
+// Paint color (one value per image channel) over an 8-bit image wherever the
+// edge mask is set
+void overlayEdges(const cv::Mat& image, const BitMask& edges, cv::Mat& output, const cv::Scalar& color);
+
+} // namespace EdgeFilters
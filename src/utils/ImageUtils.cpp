@@ -0,0 +1,255 @@
+#include "ImageUtils.h"
+#include "ParallelUtils.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IMAGEUTILS_SSE2 1
+#endif
+
+namespace {
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+
+inline uint64_t rotateLeft(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t mixLane(uint64_t hash, uint64_t lane) {
+    lane *= kPrime2;
+    lane = rotateLeft(lane, 31);
+    lane *= kPrime1;
+    hash ^= lane;
+    return rotateLeft(hash, 27) * kPrime1 + kPrime3;
+}
+
+inline uint64_t avalanche(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Image hashing works on 64-byte stripes split into eight 8-byte lanes, each
+// lane mixed with a 32x32->64 bit multiply that SSE2 does two at a time.
+// Accumulators are scrambled after every block and at the end of each row,
+// so row order matters and the result does not depend on the instruction set.
+const size_t kStripeBytes = 64;
+const size_t kStripesPerBlock = 16;
+const uint32_t kScramblePrime = 0x9E3779B1U;
+
+alignas(16) const uint64_t kSecret[8] = {
+    0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+    0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL
+};
+
+#ifdef IMAGEUTILS_SSE2
+
+void hashStripes(uint64_t* accumulators, const unsigned char* data, size_t stripes, bool endOfRow) {
+    __m128i acc[4];
+    __m128i secret[4];
+    for (int i = 0; i < 4; i++) {
+        acc[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(accumulators) + i);
+        secret[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(kSecret) + i);
+    }
+    const __m128i prime = _mm_set1_epi32(static_cast<int>(kScramblePrime));
+
+    for (size_t s = 0; s < stripes; s++) {
+        const __m128i* stripe = reinterpret_cast<const __m128i*>(data + s * kStripeBytes);
+        for (int i = 0; i < 4; i++) {
+            __m128i value = _mm_loadu_si128(stripe + i);
+            __m128i keyed = _mm_xor_si128(value, secret[i]);
+            __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m128i swapped = _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2));
+            acc[i] = _mm_add_epi64(acc[i], _mm_add_epi64(product, swapped));
+        }
+
+        // Scramble at block boundaries and after the last stripe of the row
+        if ((s + 1) % kStripesPerBlock == 0 || (endOfRow && s + 1 == stripes)) {
+            for (int i = 0; i < 4; i++) {
+                __m128i value = _mm_xor_si128(acc[i], _mm_srli_epi64(acc[i], 47));
+                value = _mm_xor_si128(value, secret[i]);
+                __m128i low = _mm_mul_epu32(value, prime);
+                __m128i high = _mm_mul_epu32(_mm_srli_epi64(value, 32), prime);
+                acc[i] = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+            }
+        }
+    }
+
+    for (int i = 0; i < 4; i++) {
+        _mm_store_si128(reinterpret_cast<__m128i*>(accumulators) + i, acc[i]);
+    }
+}
+
+#else
+
+void hashStripes(uint64_t* accumulators, const unsigned char* data, size_t stripes, bool endOfRow) {
+    for (size_t s = 0; s < stripes; s++) {
+        const unsigned char* stripe = data + s * kStripeBytes;
+        for (int i = 0; i < 8; i++) {
+            uint64_t value;
+            std::memcpy(&value, stripe + i * 8, sizeof(value));
+            uint64_t keyed = value ^ kSecret[i];
+            accumulators[i ^ 1] += value;
+            accumulators[i] += (keyed & 0xFFFFFFFFULL) * (keyed >> 32);
+        }
+
+        // Scramble at block boundaries and after the last stripe of the row
+        if ((s + 1) % kStripesPerBlock == 0 || (endOfRow && s + 1 == stripes)) {
+            for (int i = 0; i < 8; i++) {
+                uint64_t value = accumulators[i];
+                value ^= value >> 47;
+                value ^= kSecret[i];
+                accumulators[i] = value * kScramblePrime;
+            }
+        }
+    }
+}
+
+#endif
+
+} // namespace
+
+namespace ImageUtils {
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed ^ (static_cast<uint64_t>(size) * kPrime1);
+
+    // Main loop over 8-byte lanes
+    while (size >= 8) {
+        uint64_t lane;
+        std::memcpy(&lane, bytes, sizeof(lane));
+        hash = mixLane(hash, lane);
+        bytes += 8;
+        size -= 8;
+    }
+
+    // Remaining tail bytes
+    if (size > 0) {
+        uint64_t lane = 0;
+        std::memcpy(&lane, bytes, size);
+        hash = mixLane(hash, lane);
+    }
+
+    return avalanche(hash);
+}
+
+uint64_t combineHash(uint64_t hash, uint64_t value) {
+    return avalanche(hash ^ (value + kPrime1 + (hash << 6) + (hash >> 2)));
+}
+
+uint64_t hashImage(const cv::Mat& image) {
+    // Geometry and type are part of the identity
+    uint64_t hash = combineHash(static_cast<uint64_t>(image.type()), static_cast<uint64_t>(image.rows));
+    hash = combineHash(hash, static_cast<uint64_t>(image.cols));
+
+    if (image.empty()) {
+        return hash;
+    }
+
+    alignas(16) uint64_t accumulators[8];
+    for (int i = 0; i < 8; i++) {
+        accumulators[i] = kSecret[i] + hash;
+    }
+
+    // Hash row by row so ROIs and padded images match their continuous copies
+    size_t rowBytes = image.cols * image.elemSize();
+    size_t fullStripes = rowBytes / kStripeBytes;
+    size_t tailBytes = rowBytes % kStripeBytes;
+    unsigned char tail[kStripeBytes];
+    for (int y = 0; y < image.rows; y++) {
+        const unsigned char* row = image.ptr(y);
+        if (tailBytes == 0) {
+            hashStripes(accumulators, row, fullStripes, true);
+            continue;
+        }
+
+        // The partial stripe at the end of the row is zero padded
+        hashStripes(accumulators, row, fullStripes, false);
+        std::memcpy(tail, row + fullStripes * kStripeBytes, tailBytes);
+        std::memset(tail + tailBytes, 0, kStripeBytes - tailBytes);
+        hashStripes(accumulators, tail, 1, true);
+    }
+
+    // Fold the lanes into the result
+    for (int i = 0; i < 8; i++) {
+        hash = combineHash(hash, accumulators[i]);
+    }
+    return hash;
+}
+
+void applyLookup(const cv::Mat& input, cv::Mat& output, const uint8_t* table, bool keepAlpha) {
+    if (input.empty()) {
+        output = cv::Mat();
+        return;
+    }
+    CV_Assert(input.depth() == CV_8U);
+
+    // The output is always a new image, so input and output may be the same Mat
+    cv::Mat result(input.size(), input.type());
+    size_t lineBytes = input.cols * input.elemSize();
+    bool bgra = keepAlpha && input.channels() == 4;
+
+    ParallelUtils::parallelFor(input.rows, ParallelUtils::stripeRows(lineBytes), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            const uint8_t* src = input.ptr(y);
+            uint8_t* dst = result.ptr(y);
+            if (bgra) {
+                // Pixels stay interleaved, the alpha byte is a plain copy
+                for (size_t i = 0; i < lineBytes; i += 4) {
+                    dst[i] = table[src[i]];
+                    dst[i + 1] = table[src[i + 1]];
+                    dst[i + 2] = table[src[i + 2]];
+                    dst[i + 3] = src[i + 3];
+                }
+            } else {
+                for (size_t i = 0; i < lineBytes; i++) {
+                    dst[i] = table[src[i]];
+                }
+            }
+        }
+    });
+
+    output = result;
+}
+
+cv::Mat makeThumbnail(const cv::Mat& image, int maxSize) {
+    if (image.empty() || std::max(image.rows, image.cols) <= maxSize) {
+        return image;
+    }
+
+    double scale = static_cast<double>(maxSize) / std::max(image.rows, image.cols);
+    cv::Size size(std::max(1, cvRound(image.cols * scale)), std::max(1, cvRound(image.rows * scale)));
+
+    cv::Mat thumbnail;
+    cv::resize(image, thumbnail, size, 0, 0, cv::INTER_AREA);
+    return thumbnail;
+}
+
+QImage toQImage(const cv::Mat& image) {
+    if (image.empty() || image.depth() != CV_8U) {
+        return QImage();
+    }
+
+    switch (image.channels()) {
+        case 1:
+            return QImage(image.data, image.cols, image.rows, static_cast<int>(image.step),
+                          QImage::Format_Grayscale8).copy();
+        case 3:
+            return QImage(image.data, image.cols, image.rows, static_cast<int>(image.step),
+                          QImage::Format_RGB888).rgbSwapped();
+        case 4:
+            return QImage(image.data, image.cols, image.rows, static_cast<int>(image.step),
+                          QImage::Format_ARGB32).copy();
+        default:
+            return QImage();
+    }
+}
+
+} // namespace ImageUtils
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/opencv.hpp>
+#include <QImage>
+
+namespace ImageUtils {
+
+// Non-cryptographic 64-bit hash of a byte range
+uint64_t hashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+// Mix a value into a running hash
+uint64_t combineHash(uint64_t hash, uint64_t value);
+
+// Hash of the pixel data, size and type of an image, independent of row padding.
+// Vectorized with SSE2 where available, results are identical on every platform.
+uint64_t hashImage(const cv::Mat& image);
+
+// Map every channel of an 8-bit image through a 256-entry table in one
+// parallel pass. With keepAlpha set, BGRA alpha is copied unchanged.
+void applyLookup(const cv::Mat& input, cv::Mat& output, const uint8_t* table, bool keepAlpha);
+
+// Downscale an image to fit in maxSize x maxSize, preserving aspect ratio
+cv::Mat makeThumbnail(const cv::Mat& image, int maxSize);
+
+// Convert an 8-bit BGR, BGRA or grayscale image to a QImage that owns its data
+QImage toQImage(const cv::Mat& image);
+
+} // namespace ImageUtils
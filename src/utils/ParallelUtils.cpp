@@ -0,0 +1,39 @@
+#include "ParallelUtils.h"
+#include <algorithm>
+#include <opencv2/core.hpp>
+
+namespace {
+
+// Large enough to amortize scheduling, small enough to balance 16+ threads on big images
+const size_t kStripeBytes = 64 * 1024;
+
+} // namespace
+
+namespace ParallelUtils {
+
+void parallelFor(int count, int grain, const std::function<void(int begin, int end)>& body) {
+    if (count <= 0) {
+        return;
+    }
+    grain = std::max(1, grain);
+
+    // Small ranges are not worth waking the pool for
+    int stripes = (count + grain - 1) / grain;
+    if (stripes == 1) {
+        body(0, count);
+        return;
+    }
+
+    // One OpenCV stripe per range so the split stays fixed
+    cv::parallel_for_(cv::Range(0, stripes), [&](const cv::Range& range) {
+        for (int stripe = range.start; stripe < range.end; stripe++) {
+            body(stripe * grain, std::min(count, (stripe + 1) * grain));
+        }
+    }, stripes);
+}
+
+int stripeRows(size_t rowBytes) {
+    return static_cast<int>(std::max<size_t>(1, kStripeBytes / std::max<size_t>(1, rowBytes)));
+}
+
+} // namespace ParallelUtils
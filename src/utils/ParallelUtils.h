@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace ParallelUtils {
+
+// Run body(begin, end) over [0, count) on the shared worker pool. The range is
+// split into fixed stripes of grain items, so the partition (and any per-stripe
+// result) does not depend on the number of threads.
+void parallelFor(int count, int grain, const std::function<void(int begin, int end)>& body);
+
+// Rows per stripe for images with the given row size, about 64 KB of data each
+int stripeRows(size_t rowBytes);
+
+} // namespace ParallelUtils
@@ -0,0 +1,209 @@
+#include "ThresholdFilters.h"
+#include "BlurFilters.h"
+#include "ParallelUtils.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+
+namespace {
+
+// Counting into interleaved copies keeps neighbouring equal pixels from
+// stalling on the same counter, the copies are summed once per stripe
+const int kHistogramCopies = 4;
+
+void countRow(const uint8_t* src, int width, int channels, uint32_t* tables) {
+    const int tableSize = channels * 256;
+    uint32_t* t0 = tables;
+    uint32_t* t1 = tables + tableSize;
+    uint32_t* t2 = tables + 2 * tableSize;
+    uint32_t* t3 = tables + 3 * tableSize;
+
+    if (channels == 1) {
+        // Four pixels per load, one per table
+        int x = 0;
+        for (; x + 4 <= width; x += 4) {
+            uint32_t quad;
+            std::memcpy(&quad, src + x, sizeof(quad));
+            t0[quad & 0xff]++;
+            t1[(quad >> 8) & 0xff]++;
+            t2[(quad >> 16) & 0xff]++;
+            t3[quad >> 24]++;
+        }
+        for (; x < width; x++) {
+            t0[src[x]]++;
+        }
+        return;
+    }
+
+    for (int x = 0; x < width; x++) {
+        uint32_t* table = tables + (x & (kHistogramCopies - 1)) * tableSize;
+        const uint8_t* pixel = src + x * channels;
+        for (int c = 0; c < channels; c++) {
+            table[c * 256 + pixel[c]]++;
+        }
+    }
+}
+
+} // namespace
+
+namespace ThresholdFilters {
+
+void histogram(const cv::Mat& image, std::vector<int>& counts) {
+    int channels = image.channels();
+    int tableSize = channels * 256;
+    counts.assign(tableSize, 0);
+    if (image.empty()) {
+        return;
+    }
+    CV_Assert(image.depth() == CV_8U);
+
+    int width = image.cols;
+    int grain = ParallelUtils::stripeRows(static_cast<size_t>(width) * channels);
+    int stripeCount = (image.rows + grain - 1) / grain;
+    std::vector<uint32_t> stripeCounts(static_cast<size_t>(stripeCount) * tableSize, 0);
+
+    ParallelUtils::parallelFor(image.rows, grain, [&](int begin, int end) {
+        std::vector<uint32_t> tables(kHistogramCopies * tableSize, 0);
+        for (int y = begin; y < end; y++) {
+            countRow(image.ptr<uint8_t>(y), width, channels, &tables[0]);
+        }
+
+        uint32_t* merged = &stripeCounts[static_cast<size_t>(begin / grain) * tableSize];
+        for (int copy = 0; copy < kHistogramCopies; copy++) {
+            const uint32_t* table = &tables[copy * tableSize];
+            for (int bin = 0; bin < tableSize; bin++) {
+                merged[bin] += table[bin];
+            }
+        }
+    });
+
+    // Merge the stripes
+    for (int stripe = 0; stripe < stripeCount; stripe++) {
+        const uint32_t* merged = &stripeCounts[static_cast<size_t>(stripe) * tableSize];
+        for (int bin = 0; bin < tableSize; bin++) {
+            counts[bin] += static_cast<int>(merged[bin]);
+        }
+    }
+}
+
+int otsuThreshold(const int* counts) {
+    // Same sums and tie-breaking as OpenCV so both pick the same threshold
+    double total = 0;
+    double mu = 0;
+    for (int i = 0; i < 256; i++) {
+        total += counts[i];
+        mu += i * static_cast<double>(counts[i]);
+    }
+    if (total <= 0) {
+        return 0;
+    }
+    double scale = 1.0 / total;
+    mu *= scale;
+
+    double mu1 = 0;
+    double q1 = 0;
+    double maxSigma = 0;
+    int maxValue = 0;
+    for (int i = 0; i < 256; i++) {
+        double p = counts[i] * scale;
+        mu1 *= q1;
+        q1 += p;
+        double q2 = 1.0 - q1;
+        if (std::min(q1, q2) < FLT_EPSILON || std::max(q1, q2) > 1.0 - FLT_EPSILON) {
+            continue;
+        }
+        mu1 = (mu1 + i * p) / q1;
+        double mu2 = (mu - q1 * mu1) / q2;
+        double sigma = q1 * q2 * (mu1 - mu2) * (mu1 - mu2);
+        if (sigma > maxSigma) {
+            maxSigma = sigma;
+            maxValue = i;
+        }
+    }
+    return maxValue;
+}
+
+void thresholdTable(int type, int threshold, uint8_t* table) {
+    CV_Assert(type >= cv::THRESH_BINARY && type <= cv::THRESH_TOZERO_INV);
+
+    for (int value = 0; value < 256; value++) {
+        bool above = value > threshold;
+        switch (type) {
+            case cv::THRESH_BINARY:     table[value] = above ? 255 : 0; break;
+            case cv::THRESH_BINARY_INV: table[value] = above ? 0 : 255; break;
+            case cv::THRESH_TRUNC:      table[value] = static_cast<uint8_t>(above ? threshold : value); break;
+            case cv::THRESH_TOZERO:     table[value] = static_cast<uint8_t>(above ? value : 0); break;
+            case cv::THRESH_TOZERO_INV: table[value] = static_cast<uint8_t>(above ? 0 : value); break;
+        }
+    }
+}
+
+void applyTable(const cv::Mat& grayscale, cv::Mat& output, const uint8_t* table, int outputChannels) {
+    if (grayscale.empty()) {
+        output = cv::Mat();
+        return;
+    }
+    CV_Assert(grayscale.type() == CV_8UC1 && (outputChannels == 1 || outputChannels == 3));
+
+    int width = grayscale.cols;
+    cv::Mat result(grayscale.size(), CV_MAKETYPE(CV_8U, outputChannels));
+    ParallelUtils::parallelFor(grayscale.rows, ParallelUtils::stripeRows(width * (outputChannels + 1)), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            const uint8_t* src = grayscale.ptr(y);
+            uint8_t* dst = result.ptr(y);
+            if (outputChannels == 1) {
+                for (int x = 0; x < width; x++) {
+                    dst[x] = table[src[x]];
+                }
+            } else {
+                // Expand straight to BGR instead of a separate GRAY2BGR pass
+                for (int x = 0; x < width; x++) {
+                    uint8_t value = table[src[x]];
+                    dst[3 * x] = value;
+                    dst[3 * x + 1] = value;
+                    dst[3 * x + 2] = value;
+                }
+            }
+        }
+    });
+
+    output = result;
+}
+
+void adaptiveMeanThreshold(const cv::Mat& grayscale, cv::Mat& output, int blockSize, int constant) {
+    if (grayscale.empty()) {
+        output = cv::Mat();
+        return;
+    }
+    CV_Assert(grayscale.type() == CV_8UC1 && blockSize % 2 == 1 && blockSize > 1);
+
+    // Replicated borders as cv::adaptiveThreshold uses, then one integral image
+    int radius = blockSize / 2;
+    cv::Mat padded;
+    cv::copyMakeBorder(grayscale, padded, radius, radius, radius, radius, cv::BORDER_REPLICATE);
+    cv::Mat integral = BlurFilters::integralImage(padded);
+
+    // With the mean rounded to nearest, mean < value + constant is the same as
+    // 2 * sum + area < 2 * area * (value + constant), so no division is needed.
+    // Box sums fit in 32 bits, the integral's wrapped totals cancel out.
+    int width = grayscale.cols;
+    uint32_t area = static_cast<uint32_t>(blockSize * blockSize);
+    cv::Mat result(grayscale.rows, width, CV_8UC1);
+    ParallelUtils::parallelFor(grayscale.rows, ParallelUtils::stripeRows(width * 2 * sizeof(uint32_t)), [&](int begin, int end) {
+        for (int y = begin; y < end; y++) {
+            const uint32_t* top = integral.ptr<uint32_t>(y);
+            const uint32_t* bottom = integral.ptr<uint32_t>(y + blockSize);
+            const uint8_t* src = grayscale.ptr(y);
+            uint8_t* dst = result.ptr(y);
+            for (int x = 0; x < width; x++) {
+                uint32_t sum = bottom[x + blockSize] - bottom[x] - top[x + blockSize] + top[x];
+                int64_t limit = 2 * static_cast<int64_t>(area) * (src[x] + constant);
+                dst[x] = static_cast<int64_t>(2 * sum + area) < limit ? 255 : 0;
+            }
+        }
+    });
+
+    output = result;
+}
+
+} // namespace ThresholdFilters
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+namespace ThresholdFilters {
+
+// Per-channel histogram of an 8-bit image, counts[channel * 256 + value].
+// Stripes count into their own tables in parallel and are merged at the end.
+void histogram(const cv::Mat& image, std::vector<int>& counts);
+
+// Otsu threshold of a 256-bin histogram, the value cv::threshold picks with
+// THRESH_OTSU for the image the histogram was taken from
+int otsuThreshold(const int* counts);
+
+// Fill a 256-entry table with cv::threshold's result for every 8-bit value,
+// for the basic types cv::THRESH_BINARY to cv::THRESH_TOZERO_INV and a
+// maximum value of 255
+void thresholdTable(int type, int threshold, uint8_t* table);
+
+// Map a one-channel 8-bit image through a 256-entry table in parallel, writing
+// each result to outputChannels (1 or 3) channels per pixel
+void applyTable(const cv::Mat& grayscale, cv::Mat& output, const uint8_t* table, int outputChannels = 1);
+
+// Mean-adaptive binary threshold of a one-channel 8-bit image: 255 where a
+// pixel is above the mean of its blockSize x blockSize neighbourhood minus
+// constant. Matches cv::adaptiveThreshold with ADAPTIVE_THRESH_MEAN_C and
+// THRESH_BINARY, but reads the means from an integral image, so the cost per
+// pixel does not grow with the block size.
+void adaptiveMeanThreshold(const cv::Mat& grayscale, cv::Mat& output, int blockSize, int constant);
+
+} // namespace ThresholdFilters